@@ -126,12 +126,18 @@ void edid_state::edid_gtf_mode(unsigned refresh, struct timings &t)
 
 // If rb == RB_CVT_V2, then alt means video-optimized (i.e. 59.94 instead of 60 Hz, etc.).
 // If rb == RB_CVT_V3, then alt means that rb_h_blank is 160 instead of 80.
-// Note: for RB_CVT_V3 this calculation is slightly different, but
-// since CVT 1.3 is not yet public, I cannot update the calculation yet. For now
-// it will follow V2. So RBv3 timings will be off for now.
+//
+// The remaining arguments only apply to RB_CVT_V3:
+// rb_h_blank is the horizontal blanking (80-200 pixels in steps of 8, 0 for
+// the default), rb_v_blank the minimum vertical blanking time in us (0 or at
+// least 460), early_vsync places the vsync directly after the minimum vertical
+// front porch and video_opt selects the 1000/1001 refresh rate (as alt does
+// for RB_CVT_V2). RBv3 rounds the pixel clock up instead of down, so the
+// refresh rate is never below the requested rate.
 timings edid_state::calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 				  double ip_freq_rqd, unsigned rb, bool int_rqd,
-				  bool margins_rqd, bool alt)
+				  bool margins_rqd, bool alt, unsigned rb_h_blank,
+				  unsigned rb_v_blank, bool early_vsync, bool video_opt)
 {
 	timings t = {};
 
@@ -148,10 +154,12 @@ timings edid_state::calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 	double interlace = int_rqd ? 0.5 : 0;
 	double total_active_pixels = h_pixels_rnd + hor_margin * 2;
 	double v_field_rate_rqd = int_rqd ? ip_freq_rqd * 2 : ip_freq_rqd;
-	double clock_step = rb == RB_CVT_V2 ? 0.001 : 0.25;
+	double clock_step = rb >= RB_CVT_V2 ? 0.001 : 0.25;
 	double h_blank = (rb == RB_CVT_V1 || (rb == RB_CVT_V3 && alt)) ? 160 : 80;
 	double rb_v_fporch = rb == RB_CVT_V1 ? 3 : 1;
-	double refresh_multiplier = (rb == RB_CVT_V2 && alt) ? 1000.0 / 1001.0 : 1;
+	double rb_min_vblank = CVT_RB_MIN_VBLANK;
+	double refresh_multiplier = ((rb == RB_CVT_V2 && alt) ||
+				     (rb == RB_CVT_V3 && video_opt)) ? 1000.0 / 1001.0 : 1;
 	double h_sync = 32;
 
 	double v_sync;
@@ -176,6 +184,13 @@ timings edid_state::calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 	if (rb >= RB_CVT_V2)
 		v_sync = 8;
 
+	if (rb == RB_CVT_V3) {
+		if (rb_h_blank)
+			h_blank = rb_h_blank;
+		if (rb_v_blank > rb_min_vblank)
+			rb_min_vblank = rb_v_blank;
+	}
+
 	if (rb == RB_NONE) {
 		double h_period_est = ((1.0 / v_field_rate_rqd) - CVT_MIN_VSYNC_BP / 1000000.0) /
 			(v_lines_rnd + vert_margin * 2 + CVT_MIN_V_PORCH + interlace) * 1000000.0;
@@ -193,19 +208,21 @@ timings edid_state::calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 		h_sync = floor(total_pixels * 0.08 / CELL_GRAN) * CELL_GRAN;
 		pixel_freq = floor((total_pixels / h_period_est) / clock_step) * clock_step;
 	} else {
-		double h_period_est = ((1000000.0 / v_field_rate_rqd) - CVT_RB_MIN_VBLANK) /
+		double h_period_est = ((1000000.0 / v_field_rate_rqd) - rb_min_vblank) /
 					(v_lines_rnd + vert_margin * 2);
-		double vbi_lines = floor(CVT_RB_MIN_VBLANK / h_period_est) + 1;
+		double vbi_lines = floor(rb_min_vblank / h_period_est) + 1;
 		double rb_min_vbi = rb_v_fporch + v_sync + CVT_MIN_V_BPORCH;
 		v_blank = vbi_lines < rb_min_vbi ? rb_min_vbi : vbi_lines;
 		double total_v_lines = v_blank + v_lines_rnd + vert_margin * 2 + interlace;
-		if (rb == RB_CVT_V1)
+		if (rb == RB_CVT_V1 || (rb == RB_CVT_V3 && early_vsync))
 			v_sync_bp = v_blank - rb_v_fporch;
 		else
 			v_sync_bp = v_sync + CVT_MIN_V_BPORCH;
 		double total_pixels = h_blank + total_active_pixels;
-		pixel_freq = floor((v_field_rate_rqd * total_v_lines * total_pixels / 1000000.0 *
-				    refresh_multiplier) / clock_step) * clock_step;
+		double freq_steps = v_field_rate_rqd * total_v_lines * total_pixels / 1000000.0 *
+			refresh_multiplier / clock_step;
+		// Ignore rounding errors when rounding up
+		pixel_freq = (rb == RB_CVT_V3 ? ceil(freq_steps - 1e-6) : floor(freq_steps)) * clock_step;
 	}
 
 	t.vbp = v_sync_bp - v_sync;
@@ -213,8 +230,14 @@ timings edid_state::calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 	t.vfp = v_blank - t.vbp - t.vsync;
 	t.pixclk_khz = round(1000.0 * pixel_freq);
 	t.hsync = h_sync;
-	t.hfp = (h_blank / 2.0) - t.hsync;
-	t.hbp = t.hfp + t.hsync;
+	if (rb == RB_CVT_V3) {
+		// The front porch is fixed, the back porch takes the rest
+		t.hfp = 8;
+		t.hbp = h_blank - t.hfp - t.hsync;
+	} else {
+		t.hfp = (h_blank / 2.0) - t.hsync;
+		t.hbp = t.hfp + t.hsync;
+	}
 	t.hborder = hor_margin;
 	t.vborder = vert_margin;
 	t.rb = rb;
@@ -226,13 +249,17 @@ timings edid_state::calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 	return t;
 }
 
-void edid_state::edid_cvt_mode(unsigned refresh, struct timings &t)
+// RB_ALT in t.rb selects the 1000/1001 refresh rate for RB_CVT_V2 and the
+// 160 pixel hblank for RB_CVT_V3, rb_h_blank and early_vsync are the RBv3
+// inputs of calc_cvt_mode().
+void edid_state::edid_cvt_mode(unsigned refresh, struct timings &t,
+			       unsigned rb_h_blank, unsigned rb_v_blank, bool early_vsync)
 {
 	unsigned hratio = t.hratio;
 	unsigned vratio = t.vratio;
 
 	t = calc_cvt_mode(t.hact, t.vact, refresh, t.rb & ~RB_ALT, t.interlaced,
-			  false, t.rb & RB_ALT);
+			  false, t.rb & RB_ALT, rb_h_blank, rb_v_blank, early_vsync);
 	t.hratio = hratio;
 	t.vratio = vratio;
 }
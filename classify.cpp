@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Classify the sink as a TV, desktop monitor, head-mounted display,
+ * projector or AV receiver.
+ *
+ * The classifier is a set of rules, each of which adds a weight to one
+ * class if it finds a signal in the EDID: the Microsoft VSDB primary use
+ * case, the DisplayID product type, the manufacturer, the image size, the
+ * video interface, the CEC physical address, the audio capabilities, the
+ * supported VICs and the product name. The class with the highest total
+ * weight wins. The confidence is its share of the total weight plus
+ * CLASSIFY_DAMPING, so a verdict based on a single weak signal (a total
+ * weight of 20 gives 50%) is not reported as certain.
+ *
+ * Only the EDID bytes are read through the edid-view.h views, nothing is
+ * decoded, so this is cheap enough to run on every hotplug.
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "edid-view.h"
+
+#define CLASSIFY_DAMPING 20
+
+enum sink_class {
+	SINK_TV,
+	SINK_MONITOR,
+	SINK_HMD,
+	SINK_PROJECTOR,
+	SINK_AVR,
+	SINK_NUM_CLASSES
+};
+
+static const char *sink_class_names[] = {
+	"TV", "Monitor", "HMD", "Projector", "AV receiver",
+};
+
+struct evidence {
+	sink_class cls;
+	unsigned weight;
+	std::string reason;
+};
+
+typedef std::vector<evidence> evidence_list;
+
+static void add(evidence_list &ev, sink_class cls, unsigned weight, const char *fmt, ...)
+{
+	char buf[256];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	ev.push_back({ cls, weight, buf });
+}
+
+static void classify_use_case(evidence_list &ev, unsigned use_case, const char *src)
+{
+	switch (use_case) {
+	case 3: add(ev, SINK_TV, 60, "%s: Television display", src); break;
+	case 4: add(ev, SINK_MONITOR, 60, "%s: Desktop productivity display", src); break;
+	case 5: add(ev, SINK_MONITOR, 60, "%s: Desktop gaming display", src); break;
+	case 6: add(ev, SINK_PROJECTOR, 40, "%s: Presentation display", src); break;
+	case 7: add(ev, SINK_HMD, 80, "%s: Virtual reality headset", src); break;
+	case 8: add(ev, SINK_HMD, 80, "%s: Augmented reality", src); break;
+	}
+}
+
+// Microsoft VSDB, the payload includes the OUI
+static void classify_microsoft(evidence_list &ev, byte_view p)
+{
+	unsigned use_case = p[4] & 0x1f;
+
+	switch (use_case) {
+	case 18: add(ev, SINK_MONITOR, 40, "Microsoft VSDB: Dedicated gaming display"); break;
+	case 19: add(ev, SINK_MONITOR, 30, "Microsoft VSDB: Dedicated video monitor display"); break;
+	default: classify_use_case(ev, use_case, "Microsoft VSDB"); break;
+	}
+}
+
+static void classify_displayid(evidence_list &ev, displayid_view d)
+{
+	if (!d.valid())
+		return;
+	if (d.version() >= 0x20) {
+		classify_use_case(ev, d.product_type(), "DisplayID primary use case");
+		return;
+	}
+	switch (d.product_type()) {
+	case 3: add(ev, SINK_MONITOR, 10, "DisplayID product type: Standalone display device"); break;
+	case 4: add(ev, SINK_TV, 50, "DisplayID product type: Television receiver"); break;
+	case 5: add(ev, SINK_AVR, 40, "DisplayID product type: Repeater/translator"); break;
+	case 6: add(ev, SINK_MONITOR, 10, "DisplayID product type: DIRECT DRIVE monitor"); break;
+	}
+}
+
+// Manufacturers that only make head-mounted displays
+static void classify_manufacturer(evidence_list &ev, base_block_view base)
+{
+	static const char *hmd_pnp_ids[] = { "OVR", "HVR", "VLV", "PVR" };
+	char pnp[4];
+
+	base.manufacturer(pnp);
+	for (auto id : hmd_pnp_ids)
+		if (!strcmp(pnp, id))
+			add(ev, SINK_HMD, 50, "Manufacturer %s makes head-mounted displays", pnp);
+}
+
+static void classify_size(evidence_list &ev, base_block_view base)
+{
+	unsigned w = base.x[0x15], h = base.x[0x16];
+	descriptor_view dtd = base.descriptor(0);
+	unsigned dtd_w = dtd.is_dtd() ? dtd.hsize_mm() : 0;
+	bool hmd = false;
+
+	for (const auto &e : ev)
+		hmd |= e.cls == SINK_HMD;
+
+	/*
+	 * A head-mounted display has a small panel, but often no image size.
+	 * TVs often give the aspect ratio (e.g. 160 x 90 mm) as DTD image size,
+	 * so a small DTD image size only counts if other rules found an HMD.
+	 */
+	if (!w && !h && dtd_w && dtd_w <= 200) {
+		if (hmd)
+			add(ev, SINK_HMD, 30, "Preferred timing image width is %u mm", dtd_w);
+		return;
+	}
+	if (!w && !h) {
+		add(ev, SINK_PROJECTOR, 25, "Image size is variable or undefined");
+	} else if (!w || !h) {
+		if (base.revision() >= 4)
+			add(ev, SINK_PROJECTOR, 15, "Only the aspect ratio is given");
+	} else if (w >= 85) {
+		add(ev, SINK_TV, 35, "Image width is %u cm", w);
+	} else if (w >= 60) {
+		add(ev, SINK_MONITOR, 15, "Image width is %u cm", w);
+	} else if (w >= 30) {
+		add(ev, SINK_MONITOR, 30, "Image width is %u cm", w);
+	}
+}
+
+static void classify_interface(evidence_list &ev, base_block_view base, bool has_cta)
+{
+	unsigned char input = base.x[0x14];
+
+	if (!(input & 0x80)) {
+		add(ev, SINK_MONITOR, 10, "Analog input");
+		return;
+	}
+	if (base.revision() >= 4) {
+		switch (input & 0x0f) {
+		case 1: add(ev, SINK_MONITOR, 15, "DVI interface"); return;
+		case 5: add(ev, SINK_MONITOR, 25, "DisplayPort interface"); return;
+		}
+	}
+	if (!has_cta)
+		add(ev, SINK_MONITOR, 15, "No CTA-861 Extension Block");
+}
+
+static void classify_phys_addr(evidence_list &ev, unsigned pa)
+{
+	if (!pa || pa == 0xffff)
+		return;
+	// The address of the input of a sink behind another sink
+	if (pa & 0x0fff)
+		add(ev, SINK_AVR, 40, "CEC physical address %x.%x.%x.%x is behind a repeater",
+		    pa >> 12, (pa >> 8) & 0xf, (pa >> 4) & 0xf, pa & 0xf);
+	else
+		add(ev, SINK_TV, 10, "CEC physical address %x.0.0.0 is a root input", pa >> 12);
+}
+
+static void classify_audio(evidence_list &ev, bool basic_audio, unsigned max_channels,
+			   unsigned num_formats, bool hbr_formats, unsigned speakers)
+{
+	if (!basic_audio && !num_formats) {
+		add(ev, SINK_MONITOR, 5, "No audio support");
+		return;
+	}
+	if (hbr_formats)
+		add(ev, SINK_AVR, 30, "Supports lossless compressed audio");
+	if (max_channels > 2 && (speakers & ~0x01))
+		add(ev, SINK_AVR, 20, "Supports %u channels on more than two speakers", max_channels);
+	else if (num_formats > 1)
+		add(ev, SINK_TV, 10, "Supports compressed audio");
+	else
+		add(ev, SINK_TV, 5, "Supports audio");
+}
+
+static void classify_vics(evidence_list &ev, const bool *has_vic)
+{
+	unsigned vic;
+
+	// 576i/p, 720p50, 1080i50 and 1080p50: broadcast formats
+	for (vic = 17; vic <= 31; vic++)
+		if (has_vic[vic])
+			break;
+	if (vic <= 31)
+		add(ev, SINK_TV, 5, "Supports 50 Hz broadcast VICs");
+	if (has_vic[5] || has_vic[6] || has_vic[7] || has_vic[20] || has_vic[21])
+		add(ev, SINK_TV, 5, "Supports interlaced VICs");
+}
+
+static void classify_name(evidence_list &ev, base_block_view base)
+{
+	static const struct {
+		const char *word;
+		sink_class cls;
+		unsigned weight;
+	} words[] = {
+		{ "TV", SINK_TV, 20 },
+		{ "PROJ", SINK_PROJECTOR, 30 },
+		{ "AVR", SINK_AVR, 30 },
+		{ "RECEIVER", SINK_AVR, 30 },
+		{ "RIFT", SINK_HMD, 30 },
+		{ "VIVE", SINK_HMD, 30 },
+		{ "INDEX", SINK_HMD, 30 },
+	};
+
+	for (unsigned i = 0; i < 4; i++) {
+		descriptor_view d = base.descriptor(i);
+		char name[14];
+
+		if (d.tag() != 0xfc)
+			continue;
+		d.string(name);
+		for (char *s = name; *s; s++)
+			*s = toupper(*s);
+		for (const auto &w : words)
+			if (strstr(name, w.word))
+				add(ev, w.cls, w.weight, "Product name contains '%s'", w.word);
+	}
+}
+
+static evidence_list classify_evidence(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	evidence_list ev;
+	bool has_cta = false, basic_audio = false, hbr_formats = false;
+	unsigned max_channels = 0, num_formats = 0, speakers = 0;
+	unsigned pa = 0;
+	bool has_vic[256] = {};
+	bool hdmi = false;
+
+	classify_manufacturer(ev, e.base());
+	for (auto blk : e.extensions()) {
+		cta_view cta(blk);
+
+		classify_displayid(ev, displayid_view(blk));
+		if (!cta.valid())
+			continue;
+		has_cta = true;
+		basic_audio |= cta.basic_audio();
+		for (auto db : cta.data_blocks()) {
+			sad_view sads(db);
+			svd_view svds(db);
+
+			for (unsigned i = 0; i < sads.count(); i++) {
+				unsigned fmt = sads.format(i);
+
+				max_channels = max(max_channels, sads.channels(i));
+				num_formats++;
+				// DTS-HD, MAT (Dolby TrueHD) and DST
+				hbr_formats |= fmt == 11 || fmt == 12 || fmt == 13;
+			}
+			for (unsigned i = 0; i < svds.count(); i++)
+				has_vic[svds.vic(i)] = true;
+			if (db.tag() == 0x04)
+				speakers = db.payload()[0] | (db.payload()[1] << 8);
+			if (hdmi_vsdb_view(db).valid()) {
+				hdmi = true;
+				pa = hdmi_vsdb_view(db).phys_addr();
+			}
+			if (db.oui() == 0xca125c)
+				classify_microsoft(ev, db.payload());
+		}
+	}
+	classify_interface(ev, e.base(), has_cta);
+	if (hdmi)
+		classify_phys_addr(ev, pa);
+	if (has_cta)
+		classify_audio(ev, basic_audio, max_channels, num_formats, hbr_formats, speakers);
+	classify_vics(ev, has_vic);
+	classify_name(ev, e.base());
+	// Last, since it depends on the HMD signals of the other rules
+	classify_size(ev, e.base());
+	return ev;
+}
+
+int classify(const unsigned char *edid, unsigned num_blocks)
+{
+	evidence_list ev = classify_evidence(edid, num_blocks);
+	unsigned score[SINK_NUM_CLASSES] = {};
+	unsigned total = 0, best = 0;
+
+	for (const auto &e : ev) {
+		score[e.cls] += e.weight;
+		total += e.weight;
+	}
+	for (unsigned i = 1; i < SINK_NUM_CLASSES; i++)
+		if (score[i] > score[best])
+			best = i;
+
+	if (!total) {
+		printf("Sink class: Unknown (confidence 0%%)\n");
+		return 0;
+	}
+	printf("Sink class: %s (confidence %u%%)\n", sink_class_names[best],
+	       score[best] * 100 / (total + CLASSIFY_DAMPING));
+	for (const auto &e : ev)
+		printf("  %-11s +%-3u %s\n", sink_class_names[e.cls], e.weight, e.reason.c_str());
+	return 0;
+}
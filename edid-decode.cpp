@@ -15,8 +15,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 
 #include "edid-decode.h"
+#include "edid-trace.h"
+#include "edid-validate.h"
 
 #define STR(x) #x
 #define STRING(x) STR(x)
@@ -31,6 +46,7 @@ enum output_format {
 	OUT_FMT_HEX,
 	OUT_FMT_RAW,
 	OUT_FMT_CARRAY,
+	OUT_FMT_CARRAY_ASSERT,
 	OUT_FMT_XML,
 };
 
@@ -67,6 +83,26 @@ enum Option {
 	OptListDMTs,
 	OptListVICs,
 	OptListHDMIVICs,
+	OptBenchmark,
+	OptRegistry,
+	OptRepeater,
+	OptReplay,
+	OptFix,
+	OptCVTBatch,
+	OptInferFormula,
+	OptCoverage,
+	OptStartupStats,
+	OptInfoFrames,
+	OptClassify,
+	OptPanelTimings,
+	OptIdentity,
+	OptStereo,
+	OptSemanticHash,
+	OptNegativeTests,
+	OptPll,
+	OptHdr,
+	OptPool,
+	OptShm,
 	OptLast = 256
 };
 
@@ -100,6 +136,26 @@ static struct option long_options[] = {
 	{ "list-dmts", no_argument, 0, OptListDMTs },
 	{ "list-vics", no_argument, 0, OptListVICs },
 	{ "list-hdmi-vics", no_argument, 0, OptListHDMIVICs },
+	{ "benchmark", no_argument, 0, OptBenchmark },
+	{ "registry", required_argument, 0, OptRegistry },
+	{ "repeater", required_argument, 0, OptRepeater },
+	{ "replay", required_argument, 0, OptReplay },
+	{ "fix", required_argument, 0, OptFix },
+	{ "cvt-batch", required_argument, 0, OptCVTBatch },
+	{ "infer-formula", no_argument, 0, OptInferFormula },
+	{ "coverage", no_argument, 0, OptCoverage },
+	{ "startup-stats", no_argument, 0, OptStartupStats },
+	{ "infoframes", no_argument, 0, OptInfoFrames },
+	{ "classify", no_argument, 0, OptClassify },
+	{ "panel-timings", required_argument, 0, OptPanelTimings },
+	{ "identity", no_argument, 0, OptIdentity },
+	{ "stereo", no_argument, 0, OptStereo },
+	{ "semantic-hash", required_argument, 0, OptSemanticHash },
+	{ "negative-tests", required_argument, 0, OptNegativeTests },
+	{ "pll", required_argument, 0, OptPll },
+	{ "hdr", required_argument, 0, OptHdr },
+	{ "pool", optional_argument, 0, OptPool },
+	{ "shm", required_argument, 0, OptShm },
 	{ 0, 0, 0, 0 }
 };
 
@@ -117,6 +173,8 @@ static void usage(void)
 	       "                        hex:    hex numbers in ascii text (default for stdout)\n"
 	       "                        raw:    binary data (default unless writing to stdout)\n"
 	       "                        carray: c-program struct\n"
+	       "                        carray-assert: c-program struct with a static_assert\n"
+	       "                                that validates it at compile time, see edid-validate.h\n"
 	       "                        xml:    XML data\n"
 	       "  -c, --check           Check if the EDID conforms to the standards, failures and\n"
 	       "                        warnings are reported at the end.\n"
@@ -135,11 +193,15 @@ static void usage(void)
 	       "  --skip-sha            Skip the SHA report.\n"
 	       "  --hide-serial-numbers Replace serial numbers with '...'\n"
 	       "  --version             show the edid-decode version (SHA)\n"
+	       "  --registry <file>     Read additional OUI and PNP ID names, display quirks and\n"
+	       "                        diagnostic rules from <file>.\n"
 	       "  --std <byte1>,<byte2> Show the standard timing represented by these two bytes.\n"
 	       "  --dmt <dmt>           Show the timings for the DMT with the given DMT ID.\n"
 	       "  --vic <vic>           Show the timings for this VIC.\n"
 	       "  --hdmi-vic <hdmivic>  Show the timings for this HDMI VIC.\n"
 	       "  --cvt w=<width>,h=<height>,fps=<fps>[,rb=<rb>][,interlaced][,overscan][,alt]\n"
+	       "        [,hblank=<pixels>][,vblank=<us>][,early-vsync][,video-opt]\n"
+	       "        [,min-fps=<fps>][,fps-step=<step>]\n"
 	       "                        Calculate the CVT timings for the given format.\n"
 	       "                        <fps> is frames per second for progressive timings,\n"
 	       "                        or fields per second for interlaced timings.\n"
@@ -151,6 +213,52 @@ static void usage(void)
 	       "                        optimized for video: 1000 / 1001 * <fps>.\n"
 	       "                        If 'alt' is given and <rb>=3, then the horizontal blanking\n"
 	       "                        is 160 instead of 80 pixels.\n"
+	       "                        For <rb>=3 'hblank' sets the horizontal blanking (80-200\n"
+	       "                        pixels in steps of 8), 'vblank' the minimum vertical blanking\n"
+	       "                        time (>= 460 us), 'early-vsync' starts the vsync right after\n"
+	       "                        the minimum front porch and 'video-opt' selects the\n"
+	       "                        1000 / 1001 * <fps> refresh rate.\n"
+	       "                        If 'min-fps' is given, then report the fixed VTotal VRR\n"
+	       "                        family from <min-fps> to <fps> in steps of <step> (default 1).\n"
+	       "  --cvt-batch <file>    Calculate the CVT timings for each line in <file>, each line\n"
+	       "                        has the --cvt syntax.\n"
+	       "  --infer-formula       Infer the GTF or CVT formula variant that generated each DTD\n"
+	       "                        of the EDID, including a secondary GTF curve fitted against\n"
+	       "                        all DTDs, and report how well it reproduces the DTDs.\n"
+	       "  --coverage            List the decoder paths the EDID exercises: extension blocks,\n"
+	       "                        data block tags, OUIs and warnings and failures, one per line.\n"
+	       "  --startup-stats       Report the time spent starting up, parsing the options, reading\n"
+	       "                        the EDID and decoding it on stderr.\n"
+	       "  --infoframes          Show the AVI, HDMI Vendor-Specific, Audio and Dynamic Range and\n"
+	       "                        Mastering InfoFrames a source sends for each mode and pixel\n"
+	       "                        format the EDID advertises, including the checksums.\n"
+	       "  --classify            Classify the sink as a TV, monitor, HMD, projector or AV receiver\n"
+	       "                        and show the confidence and the signals it is based on.\n"
+	       "  --panel-timings <fmt>[=<file>][,<fmt>[=<file>]]\n"
+	       "                        Show the DTDs as an embedded panel description, <fmt> is\n"
+	       "                        'dts' for a device tree display-timings node or 'c' for C\n"
+	       "                        display_timing, drm_display_mode and panel_desc tables.\n"
+	       "                        Each format is written to <file> if given.\n"
+	       "  --identity            Show the physical device key, the Container ID, tile ID and\n"
+	       "                        serial numbers and the capabilities on one tab separated line.\n"
+	       "  --stereo              Show the stereo 3D formats of each mode, combined from the HDMI\n"
+	       "                        VSDB, the DTDs and the DisplayID timings.\n"
+	       "  --semantic-hash <fmt> Show the hash of the EDID contents, ignoring the block order,\n"
+	       "                        placement and padding and the serial numbers. <fmt> is 'hash'\n"
+	       "                        for the hash or 'canonical' for the canonical form it hashes.\n"
+	       "  --negative-tests <dir>\n"
+	       "                        Edit the EDID to get EDIDs that each trigger a single warning\n"
+	       "                        or failure, write them to <dir> and list them.\n"
+	       "  --pll ref=<khz>,n=<min>-<max>,vco=<min>-<max>[,m=<min>-<max>][,p=<min>-<max>]\n"
+	       "        [,pfd=<min>-<max>][,frac=<bits>][,tol=<ppm>]\n"
+	       "                        Show the best pixel clock a PLL generating ref / M * N / P\n"
+	       "                        can make for each timing and its error, and suggest a CVT\n"
+	       "                        variant for the timings it cannot make within <ppm>\n"
+	       "                        (default 5000). The frequencies are in kHz, M and P default\n"
+	       "                        to 1 and N has <bits> fractional bits (default 0).\n"
+	       "  --hdr <formats>       Show the best HDR format of each mode for a source that supports\n"
+	       "                        <formats>, a comma separated list of dolby-vision,\n"
+	       "                        dolby-vision-ll, hdr10plus, hdr10, freesync-hdr and hlg, or all.\n"
 	       "  --gtf w=<width>,h=<height>[,fps=<fps>][,horfreq=<horfreq>][,pixclk=<pixclk>][,interlaced]\n"
 	       "        [,overscan][,secondary][,C=<c>][,M=<m>][,K=<k>][,J=<j>]\n"
 	       "                        Calculate the GTF timings for the given format.\n"
@@ -164,20 +272,116 @@ static void usage(void)
 	       "                        If 'secondary' is given, then the secondary GTF is used for\n"
 	       "                        reduced blanking, where <c>, <m>, <k> and <j> are parameters\n"
 	       "                        for the secondary curve.\n"
+	       "  --repeater [max-tmds=<mhz>][,max-frl=<frl>][,max-bpc=<bpc>][,audio-channels=<n>]\n"
+	       "             [,no-hdr][,no-ycbcr420][,port=<port>]\n"
+	       "                        Convert the EDID into the EDID that an HDMI repeater with these\n"
+	       "                        capabilities advertises upstream. The result is decoded, or\n"
+	       "                        written to [out] if given.\n"
+	       "  --fix <fixes>         Fix mechanical conformance failures. <fixes> is 'all' or a\n"
+	       "                        comma-separated list of: checksum, std-timing, string-padding,\n"
+	       "                        cta-padding, cta-byte3, block-map and vcdb. The fixed EDID is\n"
+	       "                        decoded, or written to [out] and checked if given.\n"
 	       "  --list-established-timings List all known Established Timings.\n"
 	       "  --list-dmts           List all known DMTs.\n"
 	       "  --list-vics           List all known VICs.\n"
 	       "  --list-hdmi-vics      List all known HDMI VICs.\n"
+	       "  --benchmark           Benchmark the decoder kernels using the given EDID as input.\n"
+	       "  --replay <speed>      Replay the hotplug trace given as input at <speed> times the\n"
+	       "                        recorded rate (0 is as fast as possible) and report the\n"
+	       "                        throughput and latency.\n"
+	       "  --pool[=workers=<n>][,timeout=<ms>]\n"
+	       "                        Decode the EDID files given as input (or listed on stdin, one\n"
+	       "                        per line) in a pool of <n> (default: number of CPUs) sandboxed\n"
+	       "                        worker processes. A worker that crashes or takes more than\n"
+	       "                        <ms> (default: 1000) to decode an EDID is replaced.\n"
+	       "  --shm <name>          Serve decode requests of a local client through the shared\n"
+	       "                        memory object <name> (see edid-shm.h) until the client asks\n"
+	       "                        to stop or the server is interrupted.\n"
 	       "  -h, --help            Display this help message.\n");
 }
 
-static std::string s_msgs[EDID_MAX_BLOCKS + 1][2];
+/*
+ * The warnings and failures of each block, the last entry is for the EDID
+ * as a whole. Only allocated by the first message, most EDIDs have few.
+ */
+static std::vector<std::string> s_msgs;
+
+static std::string &block_msgs(unsigned block, bool is_warn)
+{
+	if (s_msgs.empty())
+		s_msgs.resize(2 * (EDID_MAX_BLOCKS + 1));
+	return s_msgs[2 * block + is_warn];
+}
+static std::set<std::string> s_coverage;
+static diagnostics s_diagnostics;
+unsigned msg_generation;
+
+#ifdef ENABLE_USDT
+EDID_TRACE_SEMAPHORE(decode_start);
+EDID_TRACE_SEMAPHORE(decode_end);
+EDID_TRACE_SEMAPHORE(block_start);
+EDID_TRACE_SEMAPHORE(block_end);
+EDID_TRACE_SEMAPHORE(cta_db_start);
+EDID_TRACE_SEMAPHORE(cta_db_end);
+EDID_TRACE_SEMAPHORE(displayid_db_start);
+EDID_TRACE_SEMAPHORE(displayid_db_end);
+EDID_TRACE_SEMAPHORE(msg);
+EDID_TRACE_SEMAPHORE(registry_lookup);
+#endif
+
+/*
+ * Record a decoder path exercised by the EDID for --coverage. Warnings
+ * and failures are recorded by their format string, so a path has the
+ * same name in every build.
+ */
+void coverage(const char *fmt, ...)
+{
+	char buf[1024];
+	va_list ap;
+
+	if (!options[OptCoverage])
+		return;
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	s_coverage.insert(buf);
+}
+
+/*
+ * The name of a diagnostic for --coverage and --negative-tests: "warn" or
+ * "fail" followed by the format string on a single line.
+ */
+std::string diag_name(bool is_warn, const char *fmt)
+{
+	std::string s = fmt;
+
+	while (!s.empty() && s.back() == '\n')
+		s.pop_back();
+	for (auto &c : s)
+		if (c == '\n' || c == '\t')
+			c = ' ';
+	return (is_warn ? "warn " : "fail ") + s;
+}
 
 void msg(bool is_warn, const char *fmt, ...)
 {
 	char buf[1024] = "";
 	va_list ap;
 
+	switch (registry_rule(is_warn, fmt)) {
+	case REGISTRY_IGNORE:
+		return;
+	case REGISTRY_WARN:
+		is_warn = true;
+		break;
+	case REGISTRY_FAIL:
+		is_warn = false;
+		break;
+	case REGISTRY_KEEP:
+		break;
+	}
+	if (EDID_TRACE_ENABLED(msg))
+		EDID_TRACE(msg, is_warn, fnv1a_64(diag_name(is_warn, fmt)), fmt);
 	va_start(ap, fmt);
 	vsprintf(buf, fmt, ap);
 	va_end(ap);
@@ -186,10 +390,16 @@ void msg(bool is_warn, const char *fmt, ...)
 		state.warnings++;
 	else
 		state.failures++;
+	if (options[OptCoverage] || options[OptNegativeTests]) {
+		std::string s = diag_name(is_warn, fmt);
+
+		coverage("%s", s.c_str());
+		s_diagnostics.insert({ s, state.block_nr });
+	}
 	if (state.data_block.empty())
-		s_msgs[state.block_nr][is_warn] += std::string("  ") + buf;
+		block_msgs(state.block_nr, is_warn) += std::string("  ") + buf;
 	else
-		s_msgs[state.block_nr][is_warn] += "  " + state.data_block + ": " + buf;
+		block_msgs(state.block_nr, is_warn) += "  " + state.data_block + ": " + buf;
 
 	if (options[OptCheckInline])
 		printf("%s: %s", is_warn ? "WARN" : "FAIL", buf);
@@ -198,17 +408,21 @@ void msg(bool is_warn, const char *fmt, ...)
 static void show_msgs(bool is_warn)
 {
 	printf("\n%s:\n\n", is_warn ? "Warnings" : "Failures");
+	// Without any messages s_msgs was never allocated
+	if (s_msgs.empty())
+		return;
 	for (unsigned i = 0; i < state.num_blocks; i++) {
-		if (s_msgs[i][is_warn].empty())
+		const std::string &msgs = s_msgs[2 * i + is_warn];
+
+		if (msgs.empty())
 			continue;
 		printf("Block %u, %s:\n%s",
-		       i, block_name(edid[i * EDID_PAGE_SIZE]).c_str(),
-		       s_msgs[i][is_warn].c_str());
+		       i, block_name(edid[i * EDID_PAGE_SIZE]).c_str(), msgs.c_str());
 	}
-	if (s_msgs[EDID_MAX_BLOCKS][is_warn].empty())
+	if (s_msgs[2 * EDID_MAX_BLOCKS + is_warn].empty())
 		return;
 	printf("EDID:\n%s",
-	       s_msgs[EDID_MAX_BLOCKS][is_warn].c_str());
+	       s_msgs[2 * EDID_MAX_BLOCKS + is_warn].c_str());
 }
 
 
@@ -495,6 +709,9 @@ bool edid_state::print_timings(const char *prefix, const struct timings *t,
 		return false;
 	}
 
+	if (options[OptPll])
+		all_timings.push_back(timings_ext(*t, type, flags));
+
 	if (detailed && options[OptShortTimings])
 		detailed = false;
 	if (options[OptLongTimings])
@@ -540,12 +757,10 @@ bool edid_state::print_timings(const char *prefix, const struct timings *t,
 	if (rb) {
 		bool alt = t->rb & RB_ALT;
 		s = "RB";
-		// Mark RB_CVT_V3 as preliminary since CVT 1.3 has not been
-		// released yet.
 		if (rb == RB_CVT_V2)
 			s += std::string("v2") + (alt ? ",video-optimized" : "");
 		else if (rb == RB_CVT_V3)
-			s += std::string("v3-is-preliminary") + (alt ? ",h-blank-160" : "");
+			s += "v3" + (hbl != 80 ? ",h-blank-" + std::to_string(hbl) : "");
 	}
 	add_str(s, flags);
 	if (t->hsize_mm || t->vsize_mm)
@@ -657,6 +872,13 @@ const char *oui_name(unsigned oui, bool reverse)
 {
 	if (reverse)
 		oui = (oui >> 16) | (oui & 0xff00) | ((oui & 0xff) << 16);
+	else
+		coverage("oui %06x", oui);
+
+	const char *name = registry_oui_name(oui);
+
+	if (name)
+		return name;
 
 	switch (oui) {
 	case 0x00001a: return "AMD";
@@ -858,26 +1080,18 @@ static bool extract_edid_xorg(const char *start)
 	return state.edid_size;
 }
 
-static bool extract_edid(int fd, FILE *error)
+static bool extract_edid(std::vector<char> &edid_data, FILE *error)
 {
-	std::vector<char> edid_data;
-	char buf[EDID_PAGE_SIZE];
-
-	for (;;) {
-		ssize_t i = read(fd, buf, sizeof(buf));
-
-		if (i < 0)
-			return false;
-		if (i == 0)
-			break;
-		edid_data.insert(edid_data.end(), buf, buf + i);
-	}
-
 	if (edid_data.empty()) {
 		state.edid_size = 0;
 		return false;
 	}
 
+	size_t size = edid_data.size();
+
+	// Terminate the data so the text formats can't be parsed beyond it
+	edid_data.push_back(0);
+
 	const char *data = &edid_data[0];
 	const char *start;
 
@@ -915,23 +1129,38 @@ static bool extract_edid(int fd, FILE *error)
 	unsigned i;
 
 	/* Is the EDID provided in hex? */
-	for (i = 0; i < 32 && (isspace(data[i]) || strchr(ignore_chars, data[i]) ||
+	for (i = 0; i < 32 && i < size && (isspace(data[i]) || strchr(ignore_chars, data[i]) ||
 			       tolower(data[i]) == 'x' || isxdigit(data[i])); i++);
 
 	if (i == 32)
 		return extract_edid_hex(data);
 
 	/* Assume binary */
-	if (edid_data.size() > sizeof(edid)) {
+	if (size > sizeof(edid)) {
 		fprintf(error, "Binary EDID length %zu is greater than %zu.\n",
-			edid_data.size(), sizeof(edid));
+			size, sizeof(edid));
 		return false;
 	}
-	memcpy(edid, data, edid_data.size());
-	state.edid_size = edid_data.size();
+	memcpy(edid, data, size);
+	state.edid_size = size;
 	return true;
 }
 
+static bool read_edid_data(int fd, std::vector<char> &edid_data)
+{
+	char buf[EDID_PAGE_SIZE];
+
+	for (;;) {
+		ssize_t i = read(fd, buf, sizeof(buf));
+
+		if (i < 0)
+			return false;
+		if (i == 0)
+			return true;
+		edid_data.insert(edid_data.end(), buf, buf + i);
+	}
+}
+
 static unsigned char crc_calc(const unsigned char *b)
 {
 	unsigned char sum = 0;
@@ -969,11 +1198,15 @@ static void hexdumpedid(FILE *f, const unsigned char *edid, unsigned size)
 	}
 }
 
-static void carraydumpedid(FILE *f, const unsigned char *edid, unsigned size)
+static void carraydumpedid(FILE *f, const unsigned char *edid, unsigned size,
+			   bool validate = false)
 {
 	unsigned b, i, j;
 
-	fprintf(f, "const unsigned char edid[] = {\n");
+	if (validate)
+		fprintf(f, "#include \"edid-validate.h\"\n\nEDID_CONST unsigned char edid[] = {\n");
+	else
+		fprintf(f, "const unsigned char edid[] = {\n");
 	for (b = 0; b < size / 128; b++) {
 		const unsigned char *buf = edid + 128 * b;
 
@@ -991,6 +1224,23 @@ static void carraydumpedid(FILE *f, const unsigned char *edid, unsigned size)
 				b, crc_calc(buf));
 	}
 	fprintf(f, "};\n");
+	if (!validate)
+		return;
+
+	edid_error err = edid_validate(edid, size);
+
+	/*
+	 * Also check the conformance rules if the EDID passes them, so
+	 * later edits of the array cannot break them.
+	 */
+	if (err != EDID_OK)
+		fprintf(f, "/* edid_validate() fails: %s. */\n", edid_error2s(err));
+	fprintf(f, "#ifdef __cplusplus\n");
+	if (err == EDID_OK && edid_validate(edid, size, EDID_VALIDATE_CONFORMANCE) == EDID_OK)
+		fprintf(f, "static_assert(edid_valid(edid, EDID_VALIDATE_CONFORMANCE), \"edid[] is not a valid EDID\");\n");
+	else
+		fprintf(f, "static_assert(edid_valid(edid), \"edid[] is not a valid EDID\");\n");
+	fprintf(f, "#endif\n");
 }
 
 // This format can be read by the QuantumData EDID editor
@@ -1038,6 +1288,9 @@ static int edid_to_file(const char *to_file, enum output_format out_fmt)
 	case OUT_FMT_CARRAY:
 		carraydumpedid(out, edid, state.edid_size);
 		break;
+	case OUT_FMT_CARRAY_ASSERT:
+		carraydumpedid(out, edid, state.edid_size, true);
+		break;
 	case OUT_FMT_XML:
 		xmldumpedid(out, edid, state.edid_size);
 		break;
@@ -1048,26 +1301,11 @@ static int edid_to_file(const char *to_file, enum output_format out_fmt)
 	return 0;
 }
 
-static int edid_from_file(const char *from_file, FILE *error)
+static int edid_from_data(const char *from_file, std::vector<char> &edid_data,
+			  FILE *error)
 {
-#ifdef O_BINARY
-	// Windows compatibility
-	int flags = O_RDONLY | O_BINARY;
-#else
-	int flags = O_RDONLY;
-#endif
-	int fd;
-
-	if (!strcmp(from_file, "-")) {
-		from_file = "stdin";
-		fd = 0;
-	} else if ((fd = open(from_file, flags)) == -1) {
-		perror(from_file);
-		return -1;
-	}
-
 	odd_hex_digits = false;
-	if (!extract_edid(fd, error)) {
+	if (!extract_edid(edid_data, error)) {
 		if (!state.edid_size) {
 			fprintf(error, "EDID of '%s' was empty.\n", from_file);
 			return -1;
@@ -1085,8 +1323,6 @@ static int edid_from_file(const char *from_file, FILE *error)
 		return -1;
 	}
 	state.num_blocks = state.edid_size / EDID_PAGE_SIZE;
-	if (fd != 0)
-		close(fd);
 
 	if (memcmp(edid, "\x00\xFF\xFF\xFF\xFF\xFF\xFF\x00", 8)) {
 		fprintf(error, "No EDID header found in '%s'.\n", from_file);
@@ -1095,6 +1331,36 @@ static int edid_from_file(const char *from_file, FILE *error)
 	return 0;
 }
 
+static int edid_from_file(const char *from_file, FILE *error)
+{
+#ifdef O_BINARY
+	// Windows compatibility
+	int flags = O_RDONLY | O_BINARY;
+#else
+	int flags = O_RDONLY;
+#endif
+	int fd;
+
+	if (!strcmp(from_file, "-")) {
+		from_file = "stdin";
+		fd = 0;
+	} else if ((fd = open(from_file, flags)) == -1) {
+		perror(from_file);
+		return -1;
+	}
+
+	std::vector<char> edid_data;
+	bool ok = read_edid_data(fd, edid_data);
+
+	if (fd != 0)
+		close(fd);
+	if (!ok) {
+		perror(from_file);
+		return -1;
+	}
+	return edid_from_data(from_file, edid_data, error);
+}
+
 /* generic extension code */
 
 std::string block_name(unsigned char block)
@@ -1183,6 +1449,8 @@ void edid_state::parse_extension(const unsigned char *x)
 	if (block_nr && x[0] == 0)
 		block = "Unknown EDID Extension Block 0x00";
 	printf("Block %u, %s:\n", block_nr, block.c_str());
+	coverage("block 0x%02x", x[0]);
+	EDID_TRACE(block_start, block_nr, x[0]);
 
 	switch (x[0]) {
 	case 0x02:
@@ -1216,10 +1484,20 @@ void edid_state::parse_extension(const unsigned char *x)
 
 	data_block.clear();
 	do_checksum("", x, EDID_PAGE_SIZE);
+	EDID_TRACE(block_end, block_nr, x[0]);
 }
 
 int edid_state::parse_edid()
 {
+	registry_pin pin;
+	// Fire decode_end on every return
+	struct trace_end {
+		const edid_state &s;
+		~trace_end() { EDID_TRACE(decode_end, s.num_blocks, s.warnings, s.failures); }
+	} trace_end = { *this };
+
+	EDID_TRACE(decode_start, num_blocks);
+
 	hide_serial_numbers = options[OptHideSerialNumbers];
 
 	for (unsigned i = 1; i < num_blocks; i++)
@@ -1247,6 +1525,7 @@ int edid_state::parse_edid()
 
 	block = block_name(0x00);
 	printf("Block %u, %s:\n", block_nr, block.c_str());
+	coverage("block 0x00");
 	parse_base_block(edid);
 
 	for (unsigned i = 1; i < num_blocks; i++) {
@@ -1334,9 +1613,15 @@ enum cvt_opts {
 	CVT_OVERSCAN,
 	CVT_RB,
 	CVT_ALT,
+	CVT_HBLANK,
+	CVT_VBLANK,
+	CVT_EARLY_VSYNC,
+	CVT_VIDEO_OPT,
+	CVT_MIN_FPS,
+	CVT_FPS_STEP,
 };
 
-static int parse_cvt_subopt(char **subopt_str, double *value)
+static int parse_cvt_subopt(char **subopt_str, double *value, const char *where)
 {
 	int opt;
 	char *opt_str;
@@ -1349,21 +1634,29 @@ static int parse_cvt_subopt(char **subopt_str, double *value)
 		"overscan",
 		"rb",
 		"alt",
+		"hblank",
+		"vblank",
+		"early-vsync",
+		"video-opt",
+		"min-fps",
+		"fps-step",
 		nullptr
 	};
 
 	opt = getsubopt(subopt_str, (char* const*) subopt_list, &opt_str);
 
 	if (opt == -1) {
-		fprintf(stderr, "Invalid suboptions specified.\n");
-		usage();
+		fprintf(stderr, "%sInvalid suboptions specified.\n", where);
+		if (!*where)
+			usage();
 		std::exit(EXIT_FAILURE);
 	}
 	if (opt_str == nullptr && opt != CVT_INTERLACED && opt != CVT_ALT &&
-	    opt != CVT_OVERSCAN) {
-		fprintf(stderr, "No value given to suboption <%s>.\n",
-				subopt_list[opt]);
-		usage();
+	    opt != CVT_OVERSCAN && opt != CVT_EARLY_VSYNC && opt != CVT_VIDEO_OPT) {
+		fprintf(stderr, "%sNo value given to suboption <%s>.\n",
+				where, subopt_list[opt]);
+		if (!*where)
+			usage();
 		std::exit(EXIT_FAILURE);
 	}
 
@@ -1372,57 +1665,273 @@ static int parse_cvt_subopt(char **subopt_str, double *value)
 	return opt;
 }
 
-static void parse_cvt(char *optarg)
+struct cvt_parsed_data {
+	unsigned w, h;
+	double fps;
+	unsigned rb;
+	bool interlaced;
+	bool alt;
+	bool overscan;
+	// RBv3 only
+	unsigned hblank, vblank;
+	bool early_vsync;
+	bool video_opt;
+	// Fixed VTotal VRR family from min_fps to fps
+	double min_fps, fps_step;
+};
+
+/*
+ * Parse a --cvt specification. Errors are prefixed with where, which is
+ * empty for the --cvt option itself.
+ */
+static void parse_cvt(char *optarg, cvt_parsed_data &data, const char *where = "")
 {
-	unsigned w = 0, h = 0;
-	double fps = 0;
-	unsigned rb = RB_NONE;
-	bool interlaced = false;
-	bool alt = false;
-	bool overscan = false;
+	memset(&data, 0, sizeof(data));
+	data.fps_step = 1;
 
 	while (*optarg != '\0') {
 		int opt;
-		double opt_val;
+		double opt_val = 1;
 
-		opt = parse_cvt_subopt(&optarg, &opt_val);
+		opt = parse_cvt_subopt(&optarg, &opt_val, where);
 
 		switch (opt) {
 		case CVT_WIDTH:
-			w = round(opt_val);
+			data.w = round(opt_val);
 			break;
 		case CVT_HEIGHT:
-			h = round(opt_val);
+			data.h = round(opt_val);
 			break;
 		case CVT_FPS:
-			fps = opt_val;
+			data.fps = opt_val;
 			break;
 		case CVT_RB:
-			rb = opt_val;
+			data.rb = opt_val;
 			break;
 		case CVT_OVERSCAN:
-			overscan = true;
+			data.overscan = true;
 			break;
 		case CVT_INTERLACED:
-			interlaced = opt_val;
+			data.interlaced = opt_val;
 			break;
 		case CVT_ALT:
-			alt = opt_val;
+			data.alt = opt_val;
+			break;
+		case CVT_HBLANK:
+			data.hblank = round(opt_val);
+			break;
+		case CVT_VBLANK:
+			data.vblank = round(opt_val);
+			break;
+		case CVT_EARLY_VSYNC:
+			data.early_vsync = true;
+			break;
+		case CVT_VIDEO_OPT:
+			data.video_opt = true;
+			break;
+		case CVT_MIN_FPS:
+			data.min_fps = opt_val;
+			break;
+		case CVT_FPS_STEP:
+			data.fps_step = opt_val;
 			break;
 		default:
 			break;
 		}
 	}
 
-	if (!w || !h || !fps) {
-		fprintf(stderr, "Missing width, height and/or fps.\n");
-		usage();
+	if (!data.w || !data.h || !data.fps) {
+		fprintf(stderr, "%sMissing width, height and/or fps.\n", where);
+		if (!*where)
+			usage();
+		std::exit(EXIT_FAILURE);
+	}
+	if (data.rb != RB_CVT_V3 && (data.hblank || data.vblank || data.early_vsync)) {
+		fprintf(stderr, "%shblank, vblank and early-vsync require rb=3.\n", where);
+		std::exit(EXIT_FAILURE);
+	}
+	if (data.hblank && (data.hblank < 80 || data.hblank > 200 || data.hblank % 8)) {
+		fprintf(stderr, "%shblank must be 80-200 in steps of 8.\n", where);
+		std::exit(EXIT_FAILURE);
+	}
+	if (data.vblank && data.vblank < 460) {
+		fprintf(stderr, "%svblank must be at least 460 us.\n", where);
+		std::exit(EXIT_FAILURE);
+	}
+	if (data.video_opt && data.rb == RB_CVT_V2)
+		data.alt = true;
+	else if (data.video_opt && data.rb != RB_CVT_V3) {
+		fprintf(stderr, "%svideo-opt requires rb=2 or rb=3.\n", where);
+		std::exit(EXIT_FAILURE);
+	}
+	if (data.min_fps && (data.min_fps > data.fps || data.fps_step <= 0 || data.interlaced)) {
+		fprintf(stderr, "%smin-fps must be <= fps, fps-step must be > 0 and the format must be progressive.\n", where);
+		std::exit(EXIT_FAILURE);
+	}
+	if (data.interlaced)
+		data.fps /= 2;
+}
+
+static void show_cvt(const cvt_parsed_data &data)
+{
+	timings t = state.calc_cvt_mode(data.w, data.h, data.fps, data.rb,
+					data.interlaced, data.overscan, data.alt,
+					data.hblank, data.vblank,
+					data.early_vsync, data.video_opt);
+
+	if (!data.min_fps) {
+		state.print_timings("", &t, "CVT", "", true, false);
+		return;
+	}
+
+	/*
+	 * Fixed VTotal VRR family: the mode at the maximum refresh rate
+	 * determines the horizontal and vertical totals, lower refresh
+	 * rates only lower the pixel clock.
+	 */
+	for (unsigned i = 0; ; i++) {
+		double fps = data.min_fps + i * data.fps_step;
+		timings vrr = t;
+
+		if (fps >= data.fps - 1e-6)
+			break;
+		vrr.pixclk_khz = round(t.pixclk_khz * fps / data.fps);
+		state.print_timings("", &vrr, "CVT", "fixed-vtotal", true, false);
+	}
+	state.print_timings("", &t, "CVT", "fixed-vtotal", true, false);
+}
+
+/*
+ * Calculate the CVT timings for each line of the file, each line
+ * has the --cvt syntax. Lines starting with '#' are ignored.
+ */
+static int cvt_batch(const char *file)
+{
+	FILE *f = strcmp(file, "-") ? fopen(file, "r") : stdin;
+	char line[1024];
+	unsigned line_nr = 0;
+
+	if (!f) {
+		perror(file);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		cvt_parsed_data data;
+		std::string where;
+
+		line_nr++;
+		line[strcspn(line, " \t\r\n")] = 0;
+		if (!line[0] || line[0] == '#')
+			continue;
+		where = std::string(strcmp(file, "-") ? file : "<stdin>") + ":" +
+			std::to_string(line_nr) + ": ";
+		parse_cvt(line, data, where.c_str());
+		show_cvt(data);
+	}
+	if (f != stdin)
+		fclose(f);
+	return 0;
+}
+
+enum repeater_opts {
+	REPEATER_MAX_TMDS = 0,
+	REPEATER_MAX_FRL,
+	REPEATER_MAX_BPC,
+	REPEATER_AUDIO_CHANNELS,
+	REPEATER_NO_HDR,
+	REPEATER_NO_YCBCR420,
+	REPEATER_PORT,
+};
+
+static void parse_repeater(char *optarg, repeater_caps &caps)
+{
+	static const char * const subopt_list[] = {
+		"max-tmds",
+		"max-frl",
+		"max-bpc",
+		"audio-channels",
+		"no-hdr",
+		"no-ycbcr420",
+		"port",
+		nullptr
+	};
+
+	caps.max_tmds_mhz = 0;
+	caps.max_frl = 6;
+	caps.max_bpc = 16;
+	caps.audio_channels = 8;
+	caps.hdr = true;
+	caps.ycbcr420 = true;
+	caps.port = 1;
+
+	while (*optarg != '\0') {
+		char *opt_str;
+		int opt = getsubopt(&optarg, (char * const *)subopt_list, &opt_str);
+
+		if (opt == -1) {
+			fprintf(stderr, "Invalid suboptions specified.\n");
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+		if (opt_str == nullptr && opt != REPEATER_NO_HDR &&
+		    opt != REPEATER_NO_YCBCR420) {
+			fprintf(stderr, "No value given to suboption <%s>.\n",
+				subopt_list[opt]);
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+
+		unsigned val = opt_str ? strtoul(opt_str, nullptr, 0) : 0;
+
+		switch (opt) {
+		case REPEATER_MAX_TMDS:
+			caps.max_tmds_mhz = val;
+			break;
+		case REPEATER_MAX_FRL:
+			caps.max_frl = val;
+			break;
+		case REPEATER_MAX_BPC:
+			caps.max_bpc = val;
+			break;
+		case REPEATER_AUDIO_CHANNELS:
+			caps.audio_channels = min(val, 8U);
+			break;
+		case REPEATER_NO_HDR:
+			caps.hdr = false;
+			break;
+		case REPEATER_NO_YCBCR420:
+			caps.ycbcr420 = false;
+			break;
+		case REPEATER_PORT:
+			caps.port = val;
+			break;
+		}
+	}
+	if (!caps.port || caps.port > 15) {
+		fprintf(stderr, "The repeater port must be 1-15.\n");
 		std::exit(EXIT_FAILURE);
 	}
-	if (interlaced)
-		fps /= 2;
-	timings t = state.calc_cvt_mode(w, h, fps, rb, interlaced, overscan, alt);
-	state.print_timings("", &t, "CVT", "", true, false);
+}
+
+static unsigned parse_fix(char *optarg)
+{
+	unsigned fixes = 0;
+
+	if (!strcmp(optarg, "all"))
+		return ~0U;
+
+	while (*optarg != '\0') {
+		char *opt_str;
+		int opt = getsubopt(&optarg, (char * const *)fix_names, &opt_str);
+
+		if (opt == -1) {
+			fprintf(stderr, "Unknown fix specified.\n");
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+		fixes |= 1U << opt;
+	}
+	return fixes;
 }
 
 struct gtf_parsed_data {
@@ -1585,48 +2094,826 @@ static void show_gtf(gtf_parsed_data &data)
 	state.print_timings("", &t, "GTF", "", true, false);
 }
 
-int main(int argc, char **argv)
+/*
+ * Microbenchmarks of the decoder kernels.
+ *
+ * Each kernel is run for a number of rounds. The number of iterations
+ * per round is calibrated so that a round takes at least BENCH_ROUND_NS.
+ * The median, minimum and spread of the per-iteration time over all rounds
+ * is reported, together with the median number of retired instructions
+ * per iteration if hardware performance counters are available.
+ */
+
+#define BENCH_ROUNDS 15
+#define BENCH_ROUND_NS 5000000ULL
+
+static std::vector<timings> bench_timings;
+static std::vector<const unsigned char *> bench_dtds;
+static const unsigned char *bench_svds;
+static unsigned bench_svds_len;
+static std::string bench_hex;
+
+static void bench_calc_cvt_mode(unsigned i)
 {
-	char short_options[26 * 2 * 2 + 1];
-	enum output_format out_fmt = OUT_FMT_DEFAULT;
-	gtf_parsed_data gtf_data;
-	int ret;
+	const timings &t = bench_timings[i % bench_timings.size()];
 
-	while (1) {
-		int option_index = 0;
-		unsigned idx = 0;
-		unsigned i, val;
-		const timings *t;
-		char buf[16];
+	state.calc_cvt_mode(t.hact, t.vact, 60, i % 4);
+}
 
-		for (i = 0; long_options[i].name; i++) {
-			if (!isalpha(long_options[i].val))
-				continue;
-			short_options[idx++] = long_options[i].val;
-			if (long_options[i].has_arg == required_argument)
-				short_options[idx++] = ':';
-		}
-		short_options[idx] = 0;
-		int ch = getopt_long(argc, argv, short_options,
-				     long_options, &option_index);
-		if (ch == -1)
-			break;
+static void bench_calc_gtf_mode(unsigned i)
+{
+	const timings &t = bench_timings[i % bench_timings.size()];
 
-		options[ch] = 1;
-		switch (ch) {
-		case OptHelp:
-			usage();
-			return -1;
-		case OptOutputFormat:
-			if (!strcmp(optarg, "hex")) {
-				out_fmt = OUT_FMT_HEX;
-			} else if (!strcmp(optarg, "raw")) {
-				out_fmt = OUT_FMT_RAW;
-			} else if (!strcmp(optarg, "carray")) {
-				out_fmt = OUT_FMT_CARRAY;
-			} else if (!strcmp(optarg, "xml")) {
-				out_fmt = OUT_FMT_XML;
-			} else {
+	state.calc_gtf_mode(t.hact, t.vact, 60, false, gtf_ip_vert_freq,
+			    false, i & 1, state.base.C, state.base.M,
+			    state.base.K, state.base.J);
+}
+
+static void bench_detailed_timings(unsigned i)
+{
+	state.base.dtd_cnt = 0;
+	state.detailed_timings("", bench_dtds[i % bench_dtds.size()]);
+}
+
+static void bench_cta_svd(unsigned i)
+{
+	state.cta.first_svd = true;
+	state.cta_svd(bench_svds, bench_svds_len, false);
+}
+
+static void bench_print_timings(unsigned i)
+{
+	state.print_timings("", &bench_timings[i % bench_timings.size()], "DTD 1");
+}
+
+static void bench_extract_edid_hex(unsigned i)
+{
+	state.edid_size = 0;
+	extract_edid_hex(bench_hex.c_str());
+}
+
+static void bench_hex_block(unsigned i)
+{
+	hex_block("", edid + (i % state.num_blocks) * EDID_PAGE_SIZE, EDID_PAGE_SIZE);
+}
+
+static void bench_find_vic_dmt_id(unsigned i)
+{
+	find_vic_id(1 + i % 219);
+	find_dmt_id(1 + i % 0x58);
+}
+
+static void bench_timings_close_match(unsigned i)
+{
+	timings_close_match(bench_timings[0], *find_vic_id(16));
+}
+
+static void bench_cta_close_match_to_vic(unsigned i)
+{
+	const timings &t = bench_timings[i % bench_timings.size()];
+	unsigned vic;
+
+	cta_close_match_to_vic(t, vic);
+}
+
+static void bench_do_checksum(unsigned i)
+{
+	do_checksum("", edid + (i % state.num_blocks) * EDID_PAGE_SIZE, EDID_PAGE_SIZE);
+}
+
+static void bench_msg(unsigned i)
+{
+	msg(i & 1, "Benchmark message %u.\n", i);
+}
+
+static const struct {
+	const char *name;
+	void (*func)(unsigned i);
+} bench_kernels[] = {
+	{ "calc_cvt_mode", bench_calc_cvt_mode },
+	{ "calc_gtf_mode", bench_calc_gtf_mode },
+	{ "detailed_timings", bench_detailed_timings },
+	{ "cta_svd", bench_cta_svd },
+	{ "print_timings", bench_print_timings },
+	{ "extract_edid_hex", bench_extract_edid_hex },
+	{ "hex_block", bench_hex_block },
+	{ "find_vic_id/find_dmt_id", bench_find_vic_dmt_id },
+	{ "timings_close_match", bench_timings_close_match },
+	{ "cta_close_match_to_vic", bench_cta_close_match_to_vic },
+	{ "do_checksum", bench_do_checksum },
+	{ "msg", bench_msg },
+};
+
+static int perf_instr_open(void)
+{
+#ifdef __linux__
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static unsigned long long perf_instr_read(int fd)
+{
+	unsigned long long cnt = 0;
+
+	if (fd < 0 || read(fd, &cnt, sizeof(cnt)) != sizeof(cnt))
+		return 0;
+	return cnt;
+}
+
+static void perf_instr_ctl(int fd, bool enable)
+{
+#ifdef __linux__
+	if (fd < 0)
+		return;
+	if (enable) {
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	} else {
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	}
+#endif
+}
+
+static unsigned long long bench_round(void (*func)(unsigned), unsigned iters,
+				      int perf_fd, unsigned long long &instr)
+{
+	perf_instr_ctl(perf_fd, true);
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < iters; i++)
+		func(i);
+	auto end = std::chrono::steady_clock::now();
+	perf_instr_ctl(perf_fd, false);
+	instr = perf_instr_read(perf_fd);
+
+	// Don't let the accumulated messages grow without bounds
+	s_msgs.clear();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+static int open_null(void)
+{
+#ifdef _WIN32
+	return open("NUL", O_WRONLY);
+#else
+	return open("/dev/null", O_WRONLY);
+#endif
+}
+
+static int benchmark(void)
+{
+	for (unsigned i = 1; i < state.num_blocks; i++)
+		state.preparse_extension(edid + i * EDID_PAGE_SIZE);
+
+	// Collect the kernel inputs from the EDID
+	for (unsigned i = 0; i < state.num_blocks; i++) {
+		const unsigned char *x = edid + i * EDID_PAGE_SIZE;
+		unsigned offset;
+
+		if (i == 0) {
+			for (offset = 0x36; offset < 0x7e; offset += 18)
+				if (x[offset] || x[offset + 1])
+					bench_dtds.push_back(x + offset);
+			continue;
+		}
+		if (x[0] != 0x02 || x[1] < 3)
+			continue;
+		offset = x[2] < 4 ? 4 : x[2];
+		for (unsigned j = 4; j < offset; j += (x[j] & 0x1f) + 1) {
+			if (!bench_svds && (x[j] & 0xe0) == 0x40) {
+				bench_svds = x + j + 1;
+				bench_svds_len = x[j] & 0x1f;
+			}
+		}
+		for (; offset + 18 < EDID_PAGE_SIZE; offset += 18)
+			if (x[offset] || x[offset + 1])
+				bench_dtds.push_back(x + offset);
+	}
+	for (unsigned i = 0; i < 2; i++)
+		for (auto vic : state.cta.preparsed_svds[i])
+			if (find_vic_id(vic))
+				bench_timings.push_back(*find_vic_id(vic));
+	if (bench_timings.empty())
+		bench_timings.push_back(*find_dmt_id(0x52));
+	if (bench_dtds.empty())
+		bench_dtds.push_back(edid + 0x36);
+
+	for (unsigned i = 0; i < state.edid_size; i++) {
+		char buf[4];
+
+		sprintf(buf, "%02x%c", edid[i], (i % 16) == 15 ? '\n' : ' ');
+		bench_hex += buf;
+	}
+
+	// The kernels print, so send their output to /dev/null
+	fflush(stdout);
+	int saved_stdout = dup(1);
+	int null_fd = open_null();
+
+	if (saved_stdout < 0 || null_fd < 0) {
+		perror("/dev/null");
+		return -1;
+	}
+
+	int perf_fd = perf_instr_open();
+
+	printf("%-24s %10s %10s %8s %12s\n",
+	       "kernel", "ns/op", "min ns/op", "spread", "instr/op");
+	fflush(stdout);
+	for (unsigned k = 0; k < ARRAY_SIZE(bench_kernels); k++) {
+		if (bench_kernels[k].func == bench_cta_svd && !bench_svds) {
+			printf("%-24s %10s\n", bench_kernels[k].name, "no SVDs");
+			fflush(stdout);
+			continue;
+		}
+
+		double ns_per_op[BENCH_ROUNDS];
+		double instr_per_op[BENCH_ROUNDS];
+		unsigned long long instr;
+		unsigned iters = 1;
+
+		dup2(null_fd, 1);
+		// Calibrate, this also warms up the caches
+		while (bench_round(bench_kernels[k].func, iters, perf_fd, instr) < BENCH_ROUND_NS &&
+		       iters < (1U << 30))
+			iters *= 2;
+		for (unsigned r = 0; r < BENCH_ROUNDS; r++) {
+			unsigned long long ns =
+				bench_round(bench_kernels[k].func, iters, perf_fd, instr);
+
+			ns_per_op[r] = (double)ns / iters;
+			instr_per_op[r] = (double)instr / iters;
+		}
+		fflush(stdout);
+		dup2(saved_stdout, 1);
+
+		std::sort(ns_per_op, ns_per_op + BENCH_ROUNDS);
+		std::sort(instr_per_op, instr_per_op + BENCH_ROUNDS);
+		double median = ns_per_op[BENCH_ROUNDS / 2];
+
+		printf("%-24s %10.1f %10.1f %7.1f%%", bench_kernels[k].name,
+		       median, ns_per_op[0],
+		       100.0 * (ns_per_op[BENCH_ROUNDS - 1] - ns_per_op[0]) / median);
+		if (perf_fd >= 0)
+			printf(" %12.1f\n", instr_per_op[BENCH_ROUNDS / 2]);
+		else
+			printf(" %12s\n", "n/a");
+		fflush(stdout);
+	}
+	if (perf_fd >= 0)
+		close(perf_fd);
+	close(null_fd);
+	close(saved_stdout);
+	return 0;
+}
+
+/*
+ * Hotplug trace replay.
+ *
+ * A trace contains one hotplug event per line: the time in seconds since
+ * the start of the trace, the connector and the EDID file. Relative EDID
+ * file names are relative to the directory of the trace. Empty lines and
+ * lines starting with '#' are ignored:
+ *
+ *   0.000000 card0-HDMI-A-1 edids/samsung-q800t-hdmi2.1
+ *
+ * The events are decoded at the recorded times divided by the speed
+ * factor. The latency of an event runs from its scheduled time until its
+ * decode is done, so time spent waiting behind earlier events when the
+ * decoder cannot keep up is included.
+ */
+
+struct replay_event {
+	double time;
+	std::string connector;
+	std::string edid_file;
+};
+
+static void reset_state(void)
+{
+	s_msgs.clear();
+	state = edid_state();
+	msg_generation++;
+}
+
+static bool read_trace(const char *file, std::vector<replay_event> &events)
+{
+	FILE *f = strcmp(file, "-") ? fopen(file, "r") : stdin;
+	const char *slash = strrchr(file, '/');
+	std::string dir = slash ? std::string(file, slash + 1) : "";
+	char line[1024];
+	unsigned nr = 0;
+
+	if (!f) {
+		perror(file);
+		return false;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		char connector[256], edid_file[768];
+		replay_event ev;
+
+		nr++;
+		if (line[0] == '#' || !line[strspn(line, " \t\r\n")])
+			continue;
+		if (sscanf(line, "%lf %255s %767s", &ev.time, connector, edid_file) != 3 ||
+		    ev.time < 0) {
+			fprintf(stderr, "%s:%u: invalid trace event.\n", file, nr);
+			if (f != stdin)
+				fclose(f);
+			return false;
+		}
+		ev.connector = connector;
+		ev.edid_file = edid_file[0] == '/' ? edid_file : dir + edid_file;
+		events.push_back(ev);
+	}
+	if (f != stdin)
+		fclose(f);
+	if (events.empty()) {
+		fprintf(stderr, "No events in trace '%s'.\n", file);
+		return false;
+	}
+	std::stable_sort(events.begin(), events.end(),
+			 [](const replay_event &a, const replay_event &b) {
+				 return a.time < b.time;
+			 });
+	return true;
+}
+
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	size_t idx = ceil(p * sorted.size());
+
+	return sorted[idx ? idx - 1 : 0];
+}
+
+static int replay(const char *trace, double speed)
+{
+	using namespace std::chrono;
+	std::vector<replay_event> events;
+	std::set<std::string> connectors;
+	std::vector<double> latencies;
+	unsigned errors = 0, nonconforming = 0;
+
+	if (!read_trace(trace, events))
+		return -1;
+	for (const auto &ev : events)
+		connectors.insert(ev.connector);
+
+	// Pick up registry changes while the trace is replayed
+	registry_watch_start();
+
+	// Decoding prints, so send the output to /dev/null
+	fflush(stdout);
+	int saved_stdout = dup(1);
+	int null_fd = open_null();
+
+	if (saved_stdout < 0 || null_fd < 0) {
+		perror("/dev/null");
+		return -1;
+	}
+	dup2(null_fd, 1);
+
+	steady_clock::time_point start = steady_clock::now();
+
+	for (const auto &ev : events) {
+		steady_clock::time_point sched = steady_clock::now();
+
+		if (speed > 0) {
+			sched = start + duration_cast<steady_clock::duration>(
+				duration<double>(ev.time / speed));
+			std::this_thread::sleep_until(sched);
+		}
+		reset_state();
+
+		int ret = edid_from_file(ev.edid_file.c_str(), stderr);
+
+		if (!ret)
+			ret = state.parse_edid();
+		fflush(stdout);
+		latencies.push_back(duration<double, std::micro>(steady_clock::now() - sched).count());
+		if (ret == -2)
+			nonconforming++;
+		else if (ret)
+			errors++;
+	}
+
+	double total = duration<double>(steady_clock::now() - start).count();
+
+	dup2(saved_stdout, 1);
+	close(null_fd);
+	close(saved_stdout);
+
+	std::sort(latencies.begin(), latencies.end());
+	printf("Events:          %u\n", (unsigned)events.size());
+	printf("Connectors:      %u\n", (unsigned)connectors.size());
+	printf("Trace duration:  %.3f s\n", events.back().time);
+	printf("Replay duration: %.3f s\n", total);
+	printf("Throughput:      %.1f EDIDs/s\n", total > 0 ? events.size() / total : 0);
+	printf("Latency p50:     %.1f us\n", percentile(latencies, 0.5));
+	printf("Latency p99:     %.1f us\n", percentile(latencies, 0.99));
+	printf("Latency p999:    %.1f us\n", percentile(latencies, 0.999));
+	printf("Latency max:     %.1f us\n", latencies.back());
+	printf("Decode errors:   %u\n", errors);
+	if (options[OptCheck] || options[OptCheckInline])
+		printf("Non-conforming:  %u\n", nonconforming);
+	return errors ? -1 : 0;
+}
+
+// Parse the EDID without producing any output on stdout
+static int parse_edid_silently(void)
+{
+	fflush(stdout);
+	int saved_stdout = dup(1);
+	int null_fd = open_null();
+
+	if (saved_stdout < 0 || null_fd < 0) {
+		perror("/dev/null");
+		return -1;
+	}
+	dup2(null_fd, 1);
+	int ret = state.parse_edid();
+	fflush(stdout);
+	dup2(saved_stdout, 1);
+	close(null_fd);
+	close(saved_stdout);
+	return ret;
+}
+
+enum pool_opts {
+	POOL_WORKERS = 0,
+	POOL_TIMEOUT,
+};
+
+static void parse_pool(char *optarg, unsigned &workers, unsigned &timeout_ms)
+{
+	static const char * const subopt_list[] = {
+		"workers",
+		"timeout",
+		nullptr
+	};
+
+	while (*optarg != '\0') {
+		char *opt_str;
+		int opt = getsubopt(&optarg, (char * const *)subopt_list, &opt_str);
+
+		if (opt == -1 || opt_str == nullptr) {
+			fprintf(stderr, "Invalid suboptions specified.\n");
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+
+		unsigned val = strtoul(opt_str, nullptr, 0);
+
+		if (!val) {
+			fprintf(stderr, "The number of workers and the timeout must be > 0.\n");
+			std::exit(EXIT_FAILURE);
+		}
+		switch (opt) {
+		case POOL_WORKERS:
+			workers = val;
+			break;
+		case POOL_TIMEOUT:
+			timeout_ms = val;
+			break;
+		}
+	}
+}
+
+enum pll_opts {
+	PLL_REF = 0,
+	PLL_M,
+	PLL_N,
+	PLL_P,
+	PLL_VCO,
+	PLL_PFD,
+	PLL_FRAC,
+	PLL_TOL,
+};
+
+enum panel_timings_opts {
+	PANEL_TIMINGS_DTS = 0,
+	PANEL_TIMINGS_C,
+};
+
+// Without a file name a format is written to stdout
+static void parse_panel_timings(char *optarg, const char *&dts_file, const char *&c_file)
+{
+	static const char * const subopt_list[] = {
+		"dts",
+		"c",
+		nullptr
+	};
+
+	while (*optarg != '\0') {
+		char *opt_str;
+		int opt = getsubopt(&optarg, (char * const *)subopt_list, &opt_str);
+
+		switch (opt) {
+		case PANEL_TIMINGS_DTS:
+			dts_file = opt_str ? opt_str : "-";
+			break;
+		case PANEL_TIMINGS_C:
+			c_file = opt_str ? opt_str : "-";
+			break;
+		default:
+			fprintf(stderr, "Invalid suboptions specified.\n");
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void parse_pll(char *optarg, pll_config &pll)
+{
+	static const char * const subopt_list[] = {
+		"ref",
+		"m",
+		"n",
+		"p",
+		"vco",
+		"pfd",
+		"frac",
+		"tol",
+		nullptr
+	};
+
+	memset(&pll, 0, sizeof(pll));
+	pll.m_min = pll.m_max = 1;
+	pll.p_min = pll.p_max = 1;
+	pll.tolerance_ppm = 5000;
+
+	while (*optarg != '\0') {
+		char *opt_str;
+		int opt = getsubopt(&optarg, (char * const *)subopt_list, &opt_str);
+		unsigned min_val, max_val;
+
+		if (opt == -1 || opt_str == nullptr) {
+			fprintf(stderr, "Invalid suboptions specified.\n");
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+		switch (sscanf(opt_str, "%u-%u", &min_val, &max_val)) {
+		case 1:
+			max_val = min_val;
+			break;
+		case 2:
+			break;
+		default:
+			fprintf(stderr, "Invalid value '%s'.\n", opt_str);
+			std::exit(EXIT_FAILURE);
+		}
+		if (min_val > max_val) {
+			fprintf(stderr, "Invalid range '%s'.\n", opt_str);
+			std::exit(EXIT_FAILURE);
+		}
+		switch (opt) {
+		case PLL_REF:
+			pll.ref_khz = min_val;
+			break;
+		case PLL_M:
+			pll.m_min = min_val;
+			pll.m_max = max_val;
+			break;
+		case PLL_N:
+			pll.n_min = min_val;
+			pll.n_max = max_val;
+			break;
+		case PLL_P:
+			pll.p_min = min_val;
+			pll.p_max = max_val;
+			break;
+		case PLL_VCO:
+			pll.vco_min_khz = min_val;
+			pll.vco_max_khz = max_val;
+			break;
+		case PLL_PFD:
+			pll.pfd_min_khz = min_val;
+			pll.pfd_max_khz = max_val;
+			break;
+		case PLL_FRAC:
+			pll.frac_bits = min_val;
+			break;
+		case PLL_TOL:
+			pll.tolerance_ppm = min_val;
+			break;
+		}
+	}
+	if (!pll.ref_khz || !pll.n_max || !pll.vco_max_khz) {
+		fprintf(stderr, "The ref, n and vco suboptions are required.\n");
+		std::exit(EXIT_FAILURE);
+	}
+	if (!pll.m_min || !pll.p_min || pll.frac_bits > 24) {
+		fprintf(stderr, "M and P must be > 0 and frac must be <= 24.\n");
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+static unsigned parse_hdr_formats(char *optarg)
+{
+	unsigned formats = 0;
+
+	for (char *s = strtok(optarg, ","); s; s = strtok(NULL, ",")) {
+		unsigned format = hdr_parse_format(s);
+
+		if (!format) {
+			fprintf(stderr, "Unknown HDR format '%s'.\n", s);
+			usage();
+			std::exit(EXIT_FAILURE);
+		}
+		formats |= format;
+	}
+	return formats;
+}
+
+// Decode one EDID in a pool worker
+static int pool_decode(std::vector<char> &request)
+{
+	reset_state();
+	int ret = edid_from_data("request", request, stdout);
+	return ret ? ret : state.parse_edid();
+}
+
+static int pool(int argc, char **argv, unsigned workers, unsigned timeout_ms)
+{
+	std::vector<std::string> files(argv, argv + argc);
+
+	if (files.empty()) {
+		char line[4096];
+
+		while (fgets(line, sizeof(line), stdin)) {
+			line[strcspn(line, "\r\n")] = 0;
+			if (line[0])
+				files.push_back(line);
+		}
+	}
+	if (!workers)
+		workers = max(std::thread::hardware_concurrency(), 1U);
+	return worker_pool(files, workers, timeout_ms, pool_decode);
+}
+
+// Decode one EDID for a shared memory client
+static int shm_decode(std::vector<char> &request, bool check, bool raw)
+{
+	static bool check_option = options[OptCheck];
+
+	reset_state();
+	int ret = edid_from_data("request", request, stdout);
+
+	if (ret || raw) {
+		if (!ret)
+			fwrite(edid, 1, state.edid_size, stdout);
+		return ret;
+	}
+	options[OptCheck] = check_option || check;
+	return state.parse_edid();
+}
+
+// Decode an edited EDID for negative_tests()
+static diagnostics diagnose(const unsigned char *data, unsigned num_blocks)
+{
+	reset_state();
+	s_diagnostics.clear();
+	memcpy(edid, data, num_blocks * EDID_PAGE_SIZE);
+	state.edid_size = num_blocks * EDID_PAGE_SIZE;
+	state.num_blocks = num_blocks;
+	parse_edid_silently();
+	return s_diagnostics;
+}
+
+static int check_fixed_edid(void)
+{
+	options[OptCheck] = 1;
+	int ret = parse_edid_silently();
+
+	fprintf(stderr, "EDID conformity after fixes: %s\n", ret ? "FAIL" : "PASS");
+	return ret;
+}
+
+/*
+ * edid-decode is typically started for every hotplug, so the cost of
+ * starting up matters as much as the cost of decoding.
+ */
+static struct {
+	std::chrono::steady_clock::time_point main, opts, read;
+} startup;
+
+static double cpu_ms(void)
+{
+	return 1000.0 * clock() / CLOCKS_PER_SEC;
+}
+
+static double ms_between(std::chrono::steady_clock::time_point start,
+			 std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/*
+ * Only take a (vDSO) timestamp here: reading the CPU time is a system
+ * call that can be surprisingly slow the first time, so it is only read
+ * at exit if --startup-stats is given.
+ */
+static void startup_begin(void)
+{
+	startup.main = std::chrono::steady_clock::now();
+}
+
+static void show_startup_stats(void)
+{
+	fflush(stdout);
+
+	auto end = std::chrono::steady_clock::now();
+	auto read = startup.read == std::chrono::steady_clock::time_point() ?
+		startup.opts : startup.read;
+	double cpu = cpu_ms();
+
+	// edid-decode is single threaded and hardly waits, so main() is all CPU time
+	fprintf(stderr, "\nStartup statistics:\n");
+	fprintf(stderr, "  CPU time before main(): %8.3f ms\n",
+		max(cpu - ms_between(startup.main, end), 0.0));
+	fprintf(stderr, "  Option parsing:         %8.3f ms\n", ms_between(startup.main, startup.opts));
+	fprintf(stderr, "  Reading the EDID:       %8.3f ms\n", ms_between(startup.opts, read));
+	fprintf(stderr, "  Decoding and output:    %8.3f ms\n", ms_between(read, end));
+	fprintf(stderr, "  Total since main():     %8.3f ms\n", ms_between(startup.main, end));
+	fprintf(stderr, "  Total CPU time:         %8.3f ms\n", cpu);
+#ifndef _WIN32
+	struct rusage ru;
+
+	if (!getrusage(RUSAGE_SELF, &ru)) {
+		fprintf(stderr, "  Page faults:            %8ld minor, %ld major\n",
+			ru.ru_minflt, ru.ru_majflt);
+		fprintf(stderr, "  Maximum resident set:   %8ld kB\n", ru.ru_maxrss);
+	}
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	char short_options[26 * 2 * 2 + 1] = "";
+	enum output_format out_fmt = OUT_FMT_DEFAULT;
+	gtf_parsed_data gtf_data;
+	repeater_caps rep_caps;
+	double replay_speed = 1;
+	unsigned pool_workers = 0;	// the number of CPUs, looked up only if needed
+	unsigned pool_timeout_ms = 1000;
+	const char *shm_name = NULL;
+	const char *panel_dts_file = NULL;
+	const char *panel_c_file = NULL;
+	bool semantic_hash_canonical = false;
+	const char *negative_tests_dir = NULL;
+	pll_config pll = {};
+	unsigned hdr_formats = 0;
+	unsigned fixes = 0;
+	int ret;
+
+	startup_begin();
+	for (unsigned i = 0, idx = 0; long_options[i].name; i++) {
+		if (!isalpha(long_options[i].val))
+			continue;
+		short_options[idx++] = long_options[i].val;
+		if (long_options[i].has_arg == required_argument)
+			short_options[idx++] = ':';
+		short_options[idx] = 0;
+	}
+
+	while (1) {
+		int option_index = 0;
+		unsigned val;
+		const timings *t;
+		char buf[16];
+
+		int ch = getopt_long(argc, argv, short_options,
+				     long_options, &option_index);
+		if (ch == -1)
+			break;
+
+		options[ch] = 1;
+		switch (ch) {
+		case OptHelp:
+			usage();
+			return -1;
+		case OptOutputFormat:
+			if (!strcmp(optarg, "hex")) {
+				out_fmt = OUT_FMT_HEX;
+			} else if (!strcmp(optarg, "raw")) {
+				out_fmt = OUT_FMT_RAW;
+			} else if (!strcmp(optarg, "carray")) {
+				out_fmt = OUT_FMT_CARRAY;
+			} else if (!strcmp(optarg, "carray-assert")) {
+				out_fmt = OUT_FMT_CARRAY_ASSERT;
+			} else if (!strcmp(optarg, "xml")) {
+				out_fmt = OUT_FMT_XML;
+			} else {
 				usage();
 				exit(1);
 			}
@@ -1671,12 +2958,68 @@ int main(int argc, char **argv)
 				fprintf(stderr, "Unknown HDMI VIC code %u.\n", val);
 			}
 			break;
-		case OptCVT:
-			parse_cvt(optarg);
+		case OptCVT: {
+			cvt_parsed_data cvt_data;
+
+			parse_cvt(optarg, cvt_data);
+			show_cvt(cvt_data);
+			break;
+		}
+		case OptCVTBatch:
+			if (cvt_batch(optarg))
+				return -1;
 			break;
 		case OptGTF:
 			parse_gtf(optarg, gtf_data);
 			break;
+		case OptRegistry:
+			// The only table built at runtime, and only if asked for
+			if (!registry_load(optarg))
+				return -1;
+			break;
+		case OptRepeater:
+			parse_repeater(optarg, rep_caps);
+			break;
+		case OptFix:
+			fixes = parse_fix(optarg);
+			break;
+		case OptPool:
+			if (optarg)
+				parse_pool(optarg, pool_workers, pool_timeout_ms);
+			break;
+		case OptShm:
+			shm_name = optarg;
+			break;
+		case OptPanelTimings:
+			parse_panel_timings(optarg, panel_dts_file, panel_c_file);
+			break;
+		case OptNegativeTests:
+			negative_tests_dir = optarg;
+			break;
+		case OptPll:
+			parse_pll(optarg, pll);
+			break;
+		case OptHdr:
+			hdr_formats = parse_hdr_formats(optarg);
+			break;
+		case OptSemanticHash:
+			if (!strcmp(optarg, "canonical")) {
+				semantic_hash_canonical = true;
+			} else if (strcmp(optarg, "hash")) {
+				usage();
+				exit(1);
+			}
+			break;
+		case OptReplay: {
+			char *endptr;
+
+			replay_speed = strtod(optarg, &endptr);
+			if (*endptr || replay_speed < 0) {
+				fprintf(stderr, "Invalid replay speed '%s'.\n", optarg);
+				return -1;
+			}
+			break;
+		}
 		case ':':
 			fprintf(stderr, "Option '%s' requires a value.\n",
 				argv[optind]);
@@ -1689,11 +3032,17 @@ int main(int argc, char **argv)
 			return -1;
 		}
 	}
+	if (options[OptStartupStats]) {
+		startup.opts = std::chrono::steady_clock::now();
+		atexit(show_startup_stats);
+	}
 	if (optind == argc && options[OptVersion]) {
 		if (strlen(STRING(SHA)))
 			printf("edid-decode SHA: %s %s\n", STRING(SHA), STRING(DATE));
 		else
 			printf("edid-decode SHA: not available\n");
+		if (options[OptRegistry])
+			printf("edid-decode registry version: %u\n", registry_version());
 		return 0;
 	}
 
@@ -1710,7 +3059,7 @@ int main(int argc, char **argv)
 	    options[OptListVICs] || options[OptListHDMIVICs])
 		return 0;
 
-	if (options[OptCVT] || options[OptDMT] || options[OptVIC] ||
+	if (options[OptCVT] || options[OptCVTBatch] || options[OptDMT] || options[OptVIC] ||
 	    options[OptHDMIVIC] || options[OptSTD])
 		return 0;
 
@@ -1719,17 +3068,97 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
+	if (options[OptReplay])
+		return replay(optind == argc ? "-" : argv[optind], replay_speed);
+
+	// Pick up registry changes in the long-running modes
+	if (options[OptPool] || options[OptShm])
+		registry_watch_start();
+	if (options[OptPool])
+		return pool(argc - optind, argv + optind, pool_workers, pool_timeout_ms);
+
+	if (options[OptShm])
+		return shm_server(shm_name, shm_decode);
+
 	if (optind == argc)
 		ret = edid_from_file("-", stdout);
 	else
 		ret = edid_from_file(argv[optind], argv[optind + 1] ? stderr : stdout);
+	if (options[OptStartupStats])
+		startup.read = std::chrono::steady_clock::now();
 
 	if (ret && options[OptPhysicalAddress]) {
 		printf("f.f.f.f\n");
 		return 0;
 	}
-	if (optind < argc - 1)
-		return ret ? ret : edid_to_file(argv[optind + 1], out_fmt);
+	if (!ret && options[OptRepeater] &&
+	    !repeater_edid(edid, state.num_blocks, rep_caps))
+		fprintf(stderr, "Corrupt CTA-861 Extension Block, repeater EDID is incomplete.\n");
+	if (!ret && options[OptFix])
+		fprintf(stderr, "Applied fixes: %s\n",
+			fixes2s(fix_edid(edid, state.num_blocks, fixes)).c_str());
+	if (optind < argc - 1) {
+		if (!ret)
+			ret = edid_to_file(argv[optind + 1], out_fmt);
+		return ret || !options[OptFix] ? ret : check_fixed_edid();
+	}
+
+	if (options[OptBenchmark])
+		return ret ? ret : benchmark();
+
+	if (options[OptInferFormula]) {
+		if (!ret)
+			parse_edid_silently();
+		return ret ? ret : state.infer_formulas();
+	}
+
+	if (options[OptInfoFrames])
+		return ret ? ret : infoframe_templates(edid, state.num_blocks);
+
+	if (options[OptClassify])
+		return ret ? ret : classify(edid, state.num_blocks);
+
+	if (options[OptNegativeTests]) {
+		if (ret)
+			return ret;
+		options[OptCheck] = 1;
+		return negative_tests(edid, state.num_blocks, negative_tests_dir, diagnose);
+	}
+
+	if (options[OptPll]) {
+		if (ret)
+			return ret;
+		parse_edid_silently();
+		return state.pll_analysis(pll);
+	}
+
+	if (options[OptHdr])
+		return ret ? ret : show_hdr_modes(edid, state.num_blocks, hdr_formats);
+
+	if (options[OptSemanticHash])
+		return ret ? ret : show_semantic_hash(edid, state.num_blocks, semantic_hash_canonical);
+
+	if (options[OptStereo])
+		return ret ? ret : show_stereo_modes(edid, state.num_blocks);
+
+	if (options[OptIdentity])
+		return ret ? ret : identity_key(edid, state.num_blocks);
+
+	if (options[OptPanelTimings]) {
+		if (ret)
+			return ret;
+		parse_edid_silently();
+		return state.panel_timings(edid, panel_dts_file, panel_c_file);
+	}
+
+	if (options[OptCoverage]) {
+		if (ret)
+			return ret;
+		parse_edid_silently();
+		for (const auto &s : s_coverage)
+			printf("%s\n", s.c_str());
+		return 0;
+	}
 
 	if (options[OptGTF]) {
 		timings t;
@@ -1774,14 +3203,10 @@ int main(int argc, char **argv)
  */
 extern "C" int parse_edid(const char *input)
 {
-	for (unsigned i = 0; i < EDID_MAX_BLOCKS + 1; i++) {
-		s_msgs[i][0].clear();
-		s_msgs[i][1].clear();
-	}
+	reset_state();
 	options[OptCheck] = 1;
 	options[OptPreferredTimings] = 1;
 	options[OptNativeTimings] = 1;
-	state = edid_state();
 	int ret = edid_from_file(input, stderr);
 	return ret ? ret : state.parse_edid();
 }
@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <string.h>
 
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(*(x)))
@@ -118,6 +119,22 @@ enum gtf_ip_parm {
 
 typedef std::vector<timings_ext> vec_timings_ext;
 
+/*
+ * The constraints of a PLL that generates the pixel clock as
+ * ref_khz / M * N / P, with a fractional N of frac_bits bits.
+ * The VCO runs at ref_khz / M * N, the phase detector at ref_khz / M.
+ */
+struct pll_config {
+	unsigned ref_khz;
+	unsigned m_min, m_max;
+	unsigned n_min, n_max;
+	unsigned p_min, p_max;
+	unsigned vco_min_khz, vco_max_khz;
+	unsigned pfd_min_khz, pfd_max_khz;	// 0 if not limited
+	unsigned frac_bits;
+	unsigned tolerance_ppm;
+};
+
 struct edid_state {
 	edid_state()
 	{
@@ -201,6 +218,8 @@ struct edid_state {
 
 	unsigned warnings;
 	unsigned failures;
+	// All shown timings, only collected for --pll
+	vec_timings_ext all_timings;
 
 	// Base block state
 	struct {
@@ -313,8 +332,16 @@ struct edid_state {
 	void edid_gtf_mode(unsigned refresh, struct timings &t);
 	timings calc_cvt_mode(unsigned h_pixels, unsigned v_lines,
 			      double ip_freq_rqd, unsigned rb, bool int_rqd = false,
-			      bool margins_rqd = false, bool alt = false);
-	void edid_cvt_mode(unsigned refresh, struct timings &t);
+			      bool margins_rqd = false, bool alt = false,
+			      unsigned rb_h_blank = 0, unsigned rb_v_blank = 0,
+			      bool early_vsync = false, bool video_opt = false);
+	void edid_cvt_mode(unsigned refresh, struct timings &t,
+			   unsigned rb_h_blank = 0, unsigned rb_v_blank = 0,
+			   bool early_vsync = false);
+	int infer_formulas();
+	int panel_timings(const unsigned char *edid, const char *dts_file,
+			  const char *c_file);
+	int pll_analysis(const pll_config &pll);
 	void detailed_cvt_descriptor(const char *prefix, const unsigned char *x, bool first);
 	void print_standard_timing(const char *prefix, unsigned char b1, unsigned char b2,
 				   bool gtf_only = false, bool show_both = false);
@@ -385,7 +412,8 @@ struct edid_state {
 	void parse_displayid_type_9_timing(const unsigned char *x);
 	void parse_displayid_dynamic_video_timings_range_limits(const unsigned char *x);
 	void parse_displayid_ContainerID(const unsigned char *x);
-	void parse_displayid_type_10_timing(const unsigned char *x, bool is_cta = false);
+	void parse_displayid_type_10_timing(const unsigned char *x, unsigned sz,
+					    bool is_cta = false);
 	void preparse_displayid_block(const unsigned char *x);
 	void parse_displayid_block(const unsigned char *x);
 	void parse_displayid_vesa(const unsigned char *x);
@@ -413,15 +441,19 @@ static inline void add_str(std::string &s, const std::string &add)
 }
 
 void msg(bool is_warn, const char *fmt, ...);
+void coverage(const char *fmt, ...);
+
+// Incremented for every EDID that is parsed, so warn_once() warns once per EDID
+extern unsigned msg_generation;
 
 #ifdef _WIN32
 
 #define warn(fmt, ...) msg(true, fmt, __VA_ARGS__)
 #define warn_once(fmt, ...)				\
 	do {						\
-		static bool shown_warn;			\
-		if (!shown_warn) {			\
-			shown_warn = true;		\
+		static unsigned shown_warn;		\
+		if (shown_warn != msg_generation + 1) { \
+			shown_warn = msg_generation + 1; \
 			msg(true, fmt, __VA_ARGS__);	\
 		}					\
 	} while (0)
@@ -432,9 +464,9 @@ void msg(bool is_warn, const char *fmt, ...);
 #define warn(fmt, args...) msg(true, fmt, ##args)
 #define warn_once(fmt, args...)				\
 	do {						\
-		static bool shown_warn;			\
-		if (!shown_warn) {			\
-			shown_warn = true;		\
+		static unsigned shown_warn;		\
+		if (shown_warn != msg_generation + 1) { \
+			shown_warn = msg_generation + 1; \
 			msg(true, fmt, ##args);		\
 		}					\
 	} while (0)
@@ -462,4 +494,178 @@ const struct timings *cta_close_match_to_vic(const timings &t, unsigned &vic);
 unsigned char hdmi_vic_to_vic(unsigned char hdmi_vic);
 char *extract_string(const unsigned char *x, unsigned len);
 
+struct repeater_caps {
+	unsigned max_tmds_mhz;		// 0 if there is no TMDS limit
+	unsigned max_frl;		// Max_FRL_Rate, 0 if FRL is not supported
+	unsigned max_bpc;		// 8, 10, 12 or 16 bits per component
+	unsigned audio_channels;	// 0 if audio is not passed on
+	bool hdr;
+	bool ycbcr420;
+	unsigned port;			// the repeater input port number (1-15)
+};
+
+bool repeater_edid(unsigned char *edid, unsigned num_blocks, const repeater_caps &caps);
+
+// The fixes of fix_edid(), in the order of fix_names[]
+#define FIX_CHECKSUM		(1U << 0)
+#define FIX_STD_TIMING		(1U << 1)
+#define FIX_STRING_PADDING	(1U << 2)
+#define FIX_CTA_PADDING		(1U << 3)
+#define FIX_CTA_BYTE3		(1U << 4)
+#define FIX_BLOCK_MAP		(1U << 5)
+#define FIX_VCDB		(1U << 6)
+
+extern const char * const fix_names[];
+unsigned fix_edid(unsigned char *edid, unsigned num_blocks, unsigned fixes);
+std::string fixes2s(unsigned fixes);
+
+int infoframe_templates(const unsigned char *edid, unsigned num_blocks);
+int classify(const unsigned char *edid, unsigned num_blocks);
+// 64 bit FNV-1a hash
+unsigned long long fnv1a_64(const std::string &s);
+int identity_key(const unsigned char *edid, unsigned num_blocks);
+
+// Stereo 3D formats, bits 0-15 match the HDMI 3D_Structure_ALL bits
+#define STEREO_FRAME_PACKING		(1U << 0)
+#define STEREO_FIELD_ALTERNATIVE	(1U << 1)
+#define STEREO_LINE_ALTERNATIVE		(1U << 2)
+#define STEREO_SIDE_BY_SIDE_FULL	(1U << 3)
+#define STEREO_L_DEPTH			(1U << 4)
+#define STEREO_L_DEPTH_GFX		(1U << 5)
+#define STEREO_TOP_AND_BOTTOM		(1U << 6)
+#define STEREO_SIDE_BY_SIDE_HALF	(1U << 8)
+#define STEREO_SIDE_BY_SIDE_QUINCUNX	(1U << 15)
+#define STEREO_FIELD_SEQUENTIAL		(1U << 16)
+#define STEREO_INTERLEAVED		(1U << 17)
+#define STEREO_DUAL_INTERFACE		(1U << 18)
+#define STEREO_MULTI_VIEW		(1U << 19)
+#define STEREO_PROPRIETARY		(1U << 20)
+#define STEREO_UNSPECIFIED		(1U << 21)
+// Not a format: stereo depends on a user action (DisplayID)
+#define STEREO_USER_ACTION		(1U << 31)
+
+struct stereo_mode {
+	std::string source;	// e.g. "VIC 32", "DTD 1" or "DisplayID Type I 2"
+	unsigned hact, vact;
+	bool interlaced;
+	double refresh;
+	unsigned formats;	// STEREO_* bits
+};
+
+std::vector<stereo_mode> stereo_modes(const unsigned char *edid, unsigned num_blocks);
+std::string stereo_formats2s(unsigned formats);
+int show_stereo_modes(const unsigned char *edid, unsigned num_blocks);
+
+// HDR formats, hdr_negotiate() prefers them in this order
+#define HDR_DOLBY_VISION	(1U << 0)
+#define HDR_DOLBY_VISION_LL	(1U << 1)	// low-latency (source-led) Dolby Vision
+#define HDR_HDR10_PLUS		(1U << 2)
+#define HDR_HDR10		(1U << 3)
+#define HDR_FREESYNC		(1U << 4)	// AMD FreeSync HDR (FreeSync2_Gamma22)
+#define HDR_HLG			(1U << 5)
+#define HDR_ALL			0x3f
+
+enum hdr_encoding {
+	HDR_RGB,
+	HDR_YCBCR444,
+	HDR_YCBCR422,
+	HDR_YCBCR420,
+};
+
+// The HDR capabilities of a sink, luminance in cd/m^2 (0 if not given)
+struct hdr_caps {
+	hdr_caps() { memset(this, 0, sizeof(*this)); }
+
+	unsigned formats;		// HDR_* bits
+	unsigned char eotfs;		// as in the HDR Static Metadata Data Block
+	unsigned char metadata_types;
+	unsigned dyn_metadata_types;	// bit n is HDR Dynamic Metadata Type n
+	double min_lum, max_lum, max_fall;
+	bool bt2020_rgb, bt2020_ycc, dci_p3;
+	unsigned max_bpc[4];		// per hdr_encoding, 0 if not supported
+	bool ycbcr420[256];
+	bool ycbcr420_only[256];
+	bool has_hdmi;
+	unsigned max_tmds_mhz;		// only set for HDMI sinks
+	unsigned max_frl_gbps;
+	unsigned dv_version;
+	bool dv_yuv422_12b, dv_2160p60;
+	unsigned dv_444_bpc;		// low-latency RGB bit depth, 0 if not supported
+	const char *dv_colorimetry;
+	double dv_min_lum, dv_max_lum;
+	unsigned hdr10plus_version;
+	double fs_min_lum, fs_max_lum;
+};
+
+// The HDR format negotiated for a mode
+struct hdr_mode {
+	std::string source;	// e.g. "VIC 97" or "DTD 1"
+	unsigned char vic;	// 0 if not a VIC
+	unsigned hact, vact;
+	bool interlaced;
+	double refresh;
+	unsigned pixclk_khz;
+	unsigned format;	// a single HDR_* bit, 0 for SDR
+	hdr_encoding encoding;
+	unsigned bpc;
+	const char *eotf;
+	const char *colorimetry;
+	double min_lum, max_lum, max_fall;	// the luminance to tone map to
+};
+
+hdr_caps hdr_sink_caps(const unsigned char *edid, unsigned num_blocks);
+void hdr_negotiate(const hdr_caps &caps, unsigned source_formats, hdr_mode &mode);
+std::vector<hdr_mode> hdr_modes(const unsigned char *edid, unsigned num_blocks,
+				unsigned source_formats);
+std::string hdr_formats2s(unsigned formats);
+unsigned hdr_parse_format(const char *option);
+int show_hdr_modes(const unsigned char *edid, unsigned num_blocks, unsigned source_formats);
+
+std::string semantic_canonical(const unsigned char *edid, unsigned num_blocks);
+unsigned long long semantic_hash(const unsigned char *edid, unsigned num_blocks);
+int show_semantic_hash(const unsigned char *edid, unsigned num_blocks, bool canonical);
+
+// Maps a diagnostic ("warn <format>" or "fail <format>") to the block it was first reported in
+typedef std::map<std::string, unsigned> diagnostics;
+typedef diagnostics (*diagnose_fn)(const unsigned char *edid, unsigned num_blocks);
+int negative_tests(const unsigned char *seed, unsigned num_blocks, const char *outdir,
+		   diagnose_fn diagnose);
+
+// Pin the current registry snapshot for the lifetime of this object
+struct registry_pin {
+	registry_pin();
+	~registry_pin();
+};
+
+// What a registry rule does with a diagnostic
+enum registry_action {
+	REGISTRY_KEEP,
+	REGISTRY_IGNORE,
+	REGISTRY_WARN,
+	REGISTRY_FAIL,
+};
+
+bool registry_load(const char *file);
+void registry_watch_start();
+unsigned registry_version();
+const char *registry_oui_name(unsigned oui);
+const char *registry_pnp_name(const char *pnp);
+std::vector<std::string> registry_quirks(const char *pnp, unsigned product);
+registry_action registry_rule(bool is_warn, const char *fmt);
+std::string diag_name(bool is_warn, const char *fmt);
+
+// Decode one request in a pool worker, the result is written to stdout
+typedef int (*pool_decode_fn)(std::vector<char> &request);
+
+int worker_pool(const std::vector<std::string> &files, unsigned num_workers,
+		unsigned timeout_ms, pool_decode_fn decode);
+
+/*
+ * Decode one shared memory request, the result is written to stdout.
+ * If raw is set, the result is the extracted EDID instead of the decoded text.
+ */
+typedef int (*shm_decode_fn)(std::vector<char> &request, bool check, bool raw);
+
+int shm_server(const char *name, shm_decode_fn decode);
+
 #endif
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Shared memory transport for local edid-decode clients.
+ *
+ * edid-decode --shm <name> creates the POSIX shared memory object <name>,
+ * which holds a request ring and a response ring of EDID_SHM_SLOTS slots
+ * each. The client is the only producer of requests and the only consumer
+ * of responses, the server the other way around, so both rings are
+ * lock-free single-producer/single-consumer queues. The head and tail
+ * counters run freely and wrap at 2^32: a ring is empty if head == tail
+ * and full if head - tail == EDID_SHM_SLOTS. The side waiting for a counter
+ * to change spins briefly and then sleeps on a futex.
+ *
+ * A client decodes an EDID with:
+ *
+ *	edid_shm *shm = edid_shm_open("/my-edids");
+ *	edid_shm_req *req = edid_shm_req_slot(shm);	// NULL if full
+ *
+ *	memcpy(req->data, edid, len);
+ *	req->len = len;
+ *	req->flags = EDID_SHM_CHECK;
+ *	req->tag = 1;
+ *	edid_shm_submit(shm);
+ *
+ *	edid_shm_resp *resp = edid_shm_resp_slot(shm, true);	// NULL if the server died
+ *	fwrite(resp->data, 1, resp->len, stdout);
+ *	edid_shm_release(shm);
+ *
+ * Responses are returned in request order. Each client needs its own
+ * shared memory object and server. Linux only.
+ */
+
+#ifndef __EDID_SHM_H_
+#define __EDID_SHM_H_
+
+#include <atomic>
+#include <climits>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+
+#define EDID_SHM_MAGIC		0x45444944	// "EDID"
+#define EDID_SHM_VERSION	2
+#define EDID_SHM_SLOTS		16
+#define EDID_SHM_REQ_SIZE	32768
+#define EDID_SHM_RESP_SIZE	65536
+// How often a waiting client checks that the server is still running
+#define EDID_SHM_ALIVE_MS	100
+
+// edid_shm_req flags
+#define EDID_SHM_CHECK		(1U << 0)	// check the conformity as --check does
+#define EDID_SHM_RAW		(1U << 1)	// return the raw EDID, not the decoded text
+
+// edid_shm_resp flags
+#define EDID_SHM_TRUNCATED	(1U << 0)	// the result did not fit in the slot
+
+struct edid_shm_req {
+	uint32_t len;
+	uint32_t flags;
+	uint64_t tag;		// copied to the response
+	unsigned char data[EDID_SHM_REQ_SIZE];	// any format edid-decode accepts
+};
+
+struct edid_shm_resp {
+	uint32_t len;
+	uint32_t flags;
+	uint64_t tag;
+	int32_t status;		// the edid-decode exit status
+	char data[EDID_SHM_RESP_SIZE];
+};
+
+// Each counter has its own cache line to avoid false sharing
+struct alignas(64) edid_shm_counter {
+	std::atomic<uint32_t> v;
+	std::atomic<uint32_t> sleeping;
+};
+
+struct edid_shm {
+	uint32_t magic;
+	uint32_t version;
+	std::atomic<uint32_t> shutdown;
+	int32_t server_pid;
+	edid_shm_counter req_head;	// written by the client
+	edid_shm_counter req_tail;	// written by the server
+	edid_shm_counter resp_head;	// written by the server
+	edid_shm_counter resp_tail;	// written by the client
+	edid_shm_req req[EDID_SHM_SLOTS];
+	edid_shm_resp resp[EDID_SHM_SLOTS];
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && sizeof(unsigned) == sizeof(uint32_t),
+	      "shared memory counters must be lock-free");
+
+/*
+ * Wait until the counter no longer has the value old, or until timeout_ms
+ * has passed if it is non-zero. This may return early, so callers check
+ * the counter again.
+ */
+static inline void edid_shm_wait(edid_shm_counter &c, uint32_t old,
+				 unsigned timeout_ms = 0)
+{
+	struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+
+	for (unsigned i = 0; i < 4000; i++)
+		if (c.v.load(std::memory_order_acquire) != old)
+			return;
+	c.sleeping.store(1);
+	if (c.v.load() == old)
+		syscall(SYS_futex, &c.v, FUTEX_WAIT, old, timeout_ms ? &ts : NULL, NULL, 0);
+}
+
+static inline void edid_shm_wake(edid_shm_counter &c)
+{
+	syscall(SYS_futex, &c.v, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*
+ * Only wake up the other side if it is sleeping. Both stores must be
+ * sequentially consistent: edid_shm_wait() stores sleeping and then loads
+ * v, this stores v and then loads sleeping, and one of the two sides must
+ * see the store of the other.
+ */
+static inline void edid_shm_set(edid_shm_counter &c, uint32_t v)
+{
+	c.v.store(v);
+	if (c.sleeping.exchange(0))
+		edid_shm_wake(c);
+}
+
+static inline edid_shm *edid_shm_open(const char *name)
+{
+	int fd = shm_open(name, O_RDWR, 0);
+
+	if (fd < 0)
+		return NULL;
+
+	void *p = mmap(NULL, sizeof(edid_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	edid_shm *shm = (edid_shm *)p;
+
+	close(fd);
+	if (p == MAP_FAILED)
+		return NULL;
+	if (shm->magic != EDID_SHM_MAGIC || shm->version != EDID_SHM_VERSION) {
+		munmap(p, sizeof(edid_shm));
+		return NULL;
+	}
+	return shm;
+}
+
+// A server that exited normally has also unlinked the shared memory object
+static inline bool edid_shm_server_alive(edid_shm *shm)
+{
+	return !kill(shm->server_pid, 0) || errno == EPERM;
+}
+
+static inline void edid_shm_close(edid_shm *shm)
+{
+	munmap(shm, sizeof(edid_shm));
+}
+
+// Returns the next free request slot, or NULL if all slots are in use
+static inline edid_shm_req *edid_shm_req_slot(edid_shm *shm)
+{
+	uint32_t head = shm->req_head.v.load(std::memory_order_relaxed);
+
+	if (head - shm->req_tail.v.load(std::memory_order_acquire) == EDID_SHM_SLOTS)
+		return NULL;
+	return &shm->req[head % EDID_SHM_SLOTS];
+}
+
+// Pass the request slot returned by edid_shm_req_slot() to the server
+static inline void edid_shm_submit(edid_shm *shm)
+{
+	edid_shm_set(shm->req_head, shm->req_head.v.load(std::memory_order_relaxed) + 1);
+}
+
+/*
+ * Returns the oldest response, or NULL if there is none and wait is false
+ * or the server is no longer running.
+ */
+static inline edid_shm_resp *edid_shm_resp_slot(edid_shm *shm, bool wait)
+{
+	uint32_t tail = shm->resp_tail.v.load(std::memory_order_relaxed);
+
+	while (shm->resp_head.v.load(std::memory_order_acquire) == tail) {
+		// The server may have written a response just before it exited
+		if (!wait || (!edid_shm_server_alive(shm) &&
+			      shm->resp_head.v.load(std::memory_order_acquire) == tail))
+			return NULL;
+		edid_shm_wait(shm->resp_head, tail, EDID_SHM_ALIVE_MS);
+	}
+	return &shm->resp[tail % EDID_SHM_SLOTS];
+}
+
+// Return the response slot returned by edid_shm_resp_slot() to the server
+static inline void edid_shm_release(edid_shm *shm)
+{
+	edid_shm_set(shm->resp_tail, shm->resp_tail.v.load(std::memory_order_relaxed) + 1);
+}
+
+// Ask the server to exit once all pending requests are handled
+static inline void edid_shm_shutdown(edid_shm *shm)
+{
+	shm->shutdown.store(1);
+	edid_shm_wake(shm->req_head);
+}
+
+#endif
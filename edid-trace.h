@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MIT
+/*
+ * USDT (User Statically-Defined Tracing) probes.
+ *
+ * Build with 'make ENABLE_USDT=1' to get the probes, this needs <sys/sdt.h>
+ * (systemtap-sdt-dev or systemtap-sdt-devel). Otherwise the probes compile
+ * to nothing. An enabled probe that is not attached costs a single nop.
+ *
+ * All probes are in the edid_decode provider:
+ *
+ * decode_start(num_blocks)
+ * decode_end(num_blocks, warnings, failures)
+ *	Around the decode of a complete EDID.
+ * block_start(block_nr, tag)
+ * block_end(block_nr, tag)
+ *	Around the decode of an extension block, tag is its first byte.
+ * cta_db_start(block_nr, tag, length)
+ * cta_db_end(block_nr, tag, length)
+ *	Around the decode of a CTA-861 Data Block. tag is the data block tag
+ *	shifted left by 8, plus the extended tag for tag 7 (e.g. 0x200 for a
+ *	Video Data Block, 0x705 for a Colorimetry Data Block). length is the
+ *	number of bytes after the data block header byte.
+ * displayid_db_start(block_nr, tag, length)
+ * displayid_db_end(block_nr, tag, length)
+ *	Around the decode of a DisplayID Data Block, length is the payload
+ *	length.
+ * msg(is_warn, id, format)
+ *	A warning (is_warn is 1) or failure. id is the 64 bit FNV-1a hash of
+ *	"warn <format>" or "fail <format>" as listed by --coverage, which is
+ *	also the rule of --negative-tests. format is the printf format string.
+ * registry_lookup(kind, found)
+ *	A name lookup in the OUI/PNP ID registry, kind is 0 for an OUI and
+ *	1 for a PNP ID, found is 1 for a hit and 0 for a miss.
+ *
+ * For example, a latency histogram per CTA-861 Data Block type with
+ * bpftrace:
+ *
+ *	usdt:/usr/bin/edid-decode:edid_decode:cta_db_start { @start[tid] = nsecs; }
+ *	usdt:/usr/bin/edid-decode:edid_decode:cta_db_end /@start[tid]/ {
+ *		@ns[arg1] = hist(nsecs - @start[tid]);
+ *		delete(@start[tid]);
+ *	}
+ */
+
+#ifndef __EDID_TRACE_H_
+#define __EDID_TRACE_H_
+
+#ifdef ENABLE_USDT
+
+// Use semaphores, so the msg id is only computed if the probe is attached
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+extern unsigned short edid_decode_decode_start_semaphore;
+extern unsigned short edid_decode_decode_end_semaphore;
+extern unsigned short edid_decode_block_start_semaphore;
+extern unsigned short edid_decode_block_end_semaphore;
+extern unsigned short edid_decode_cta_db_start_semaphore;
+extern unsigned short edid_decode_cta_db_end_semaphore;
+extern unsigned short edid_decode_displayid_db_start_semaphore;
+extern unsigned short edid_decode_displayid_db_end_semaphore;
+extern unsigned short edid_decode_msg_semaphore;
+extern unsigned short edid_decode_registry_lookup_semaphore;
+
+#define EDID_TRACE(probe, ...) STAP_PROBEV(edid_decode, probe, __VA_ARGS__)
+#define EDID_TRACE_ENABLED(probe) __builtin_expect(edid_decode_##probe##_semaphore, 0)
+// Defines the semaphore of a probe, the tracer increments it while attached
+#define EDID_TRACE_SEMAPHORE(probe) \
+	unsigned short edid_decode_##probe##_semaphore __attribute__((unused, section(".probes")))
+
+#else
+
+#define EDID_TRACE(probe, ...) do { } while (0)
+#define EDID_TRACE_ENABLED(probe) 0
+
+#endif
+
+#endif
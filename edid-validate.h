@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Compile-time EDID validation.
+ *
+ * A standalone, header-only validator for EDIDs embedded as C arrays in
+ * firmware sources. All functions are C++14 constexpr, so a broken EDID
+ * fails the build instead of being found on the hardware:
+ *
+ *	#include "edid-validate.h"
+ *
+ *	EDID_CONST unsigned char edid[] = { ... };
+ *	#ifdef __cplusplus
+ *	static_assert(edid_valid(edid), "edid[] is not a valid EDID");
+ *	#endif
+ *
+ * edid-decode -o carray-assert writes an EDID in this form.
+ *
+ * The structural checks are the header, the checksums, the extension count,
+ * the CTA-861 DTD offset and Data Block Collection and the DisplayID section
+ * length, Data Blocks and checksum. Pass EDID_VALIDATE_CONFORMANCE to also
+ * check a small subset of the edid-decode --check conformance rules. Use
+ * edid_validate() instead of edid_valid() to find out which check failed.
+ *
+ * When compiled as C only EDID_CONST is defined, so the same array
+ * definition can be shared with C sources.
+ */
+
+#ifndef __EDID_VALIDATE_H_
+#define __EDID_VALIDATE_H_
+
+#ifdef __cplusplus
+
+#include <stddef.h>
+
+// An array must be constexpr to be read in a constant expression
+#define EDID_CONST constexpr
+
+// edid_validate() flags
+#define EDID_VALIDATE_CONFORMANCE	(1U << 0)
+
+enum edid_error {
+	EDID_OK,
+	EDID_ERR_SIZE,			// not 1 to 256 blocks of 128 bytes
+	EDID_ERR_HEADER,
+	EDID_ERR_CHECKSUM,
+	EDID_ERR_EXT_COUNT,		// the size does not match the extension count
+	EDID_ERR_CTA_OFFSET,
+	EDID_ERR_CTA_DATA_BLOCKS,	// the Data Blocks do not end at the DTD offset
+	EDID_ERR_DISPLAYID_LENGTH,
+	EDID_ERR_DISPLAYID_DATA_BLOCKS,	// a Data Block exceeds the section
+	EDID_ERR_DISPLAYID_CHECKSUM,
+	// Only checked with EDID_VALIDATE_CONFORMANCE
+	EDID_ERR_VERSION,
+	EDID_ERR_MANUFACTURER,
+	EDID_ERR_PREFERRED_TIMING,	// the first descriptor is not a DTD
+	EDID_ERR_STD_TIMING,		// unused Standard Timings are not 0x0101
+	EDID_ERR_STRING_PADDING,
+	EDID_ERR_CTA_PADDING,
+	EDID_ERR_DISPLAYID_PADDING,
+};
+
+constexpr const char *edid_error2s(edid_error err)
+{
+	switch (err) {
+	case EDID_OK: return "valid";
+	case EDID_ERR_SIZE: return "invalid size";
+	case EDID_ERR_HEADER: return "invalid header";
+	case EDID_ERR_CHECKSUM: return "checksum error";
+	case EDID_ERR_EXT_COUNT: return "extension count does not match the size";
+	case EDID_ERR_CTA_OFFSET: return "invalid CTA-861 DTD offset";
+	case EDID_ERR_CTA_DATA_BLOCKS: return "CTA-861 Data Blocks do not end at the DTD offset";
+	case EDID_ERR_DISPLAYID_LENGTH: return "DisplayID section is too long";
+	case EDID_ERR_DISPLAYID_DATA_BLOCKS: return "DisplayID Data Block exceeds the section";
+	case EDID_ERR_DISPLAYID_CHECKSUM: return "DisplayID section checksum error";
+	case EDID_ERR_VERSION: return "invalid EDID version";
+	case EDID_ERR_MANUFACTURER: return "invalid manufacturer ID";
+	case EDID_ERR_PREFERRED_TIMING: return "first descriptor is not a DTD";
+	case EDID_ERR_STD_TIMING: return "unused Standard Timing is not 0x0101";
+	case EDID_ERR_STRING_PADDING: return "descriptor string is not terminated or padded correctly";
+	case EDID_ERR_CTA_PADDING: return "CTA-861 padding is not 0";
+	case EDID_ERR_DISPLAYID_PADDING: return "DisplayID padding is not 0";
+	}
+	return "unknown error";
+}
+
+constexpr bool edid_validate_zero(const unsigned char *x, unsigned len)
+{
+	for (unsigned i = 0; i < len; i++)
+		if (x[i])
+			return false;
+	return true;
+}
+
+constexpr bool edid_validate_sum(const unsigned char *x, unsigned len)
+{
+	unsigned char sum = 0;
+
+	for (unsigned i = 0; i < len; i++)
+		sum += x[i];
+	return !sum;
+}
+
+// The HDMI Forum EEODB overrides the extension count of the base block
+constexpr unsigned edid_validate_eeodb(const unsigned char *edid, size_t size)
+{
+	const unsigned char *x = edid + 128;
+
+	if (size < 256 || x[0] != 0x02 || x[1] < 3 || x[2] < 7)
+		return 0;
+	if ((x[4] >> 5) != 7 || (x[4] & 0x1f) != 2 || x[5] != 0x78)
+		return 0;
+	return x[6];
+}
+
+// A descriptor string ends with 0x0a followed by spaces, unless it is 13 bytes long
+constexpr bool edid_validate_string(const unsigned char *s)
+{
+	unsigned i = 0;
+
+	while (i < 13 && s[i] != 0x0a)
+		i++;
+	if (i == 13)
+		return true;
+	for (i++; i < 13; i++)
+		if (s[i] != 0x20)
+			return false;
+	return true;
+}
+
+constexpr edid_error edid_validate_base(const unsigned char *x, unsigned flags)
+{
+	if (!(flags & EDID_VALIDATE_CONFORMANCE))
+		return EDID_OK;
+	if (x[0x12] != 1 || !x[0x13] || x[0x13] > 4)
+		return EDID_ERR_VERSION;
+
+	unsigned mfg = (x[0x08] << 8) | x[0x09];
+
+	if (mfg & 0x8000)
+		return EDID_ERR_MANUFACTURER;
+	for (unsigned shift = 0; shift <= 10; shift += 5)
+		if (((mfg >> shift) & 0x1f) < 1 || ((mfg >> shift) & 0x1f) > 26)
+			return EDID_ERR_MANUFACTURER;
+
+	if (x[0x13] >= 3 && !x[0x36] && !x[0x37])
+		return EDID_ERR_PREFERRED_TIMING;
+	for (unsigned i = 0x26; i < 0x36; i += 2)
+		if (x[i] <= 0x01 && (x[i] != 0x01 || x[i + 1] != 0x01))
+			return EDID_ERR_STD_TIMING;
+	for (unsigned i = 0x36; i < 0x7e; i += 18) {
+		const unsigned char *d = x + i;
+
+		if (d[0] || d[1] || d[2] || d[4])
+			continue;
+		if ((d[3] == 0xfc || d[3] == 0xfe || d[3] == 0xff) &&
+		    !edid_validate_string(d + 5))
+			return EDID_ERR_STRING_PADDING;
+	}
+	return EDID_OK;
+}
+
+constexpr edid_error edid_validate_cta(const unsigned char *x, unsigned flags)
+{
+	unsigned d = x[2];
+
+	if (!d)
+		return EDID_OK;
+	if (d < 4 || d > 127)
+		return EDID_ERR_CTA_OFFSET;
+
+	// CTA-861 revision 1 and 2 have no Data Block Collection
+	if (x[1] >= 3) {
+		unsigned i = 4;
+
+		while (i < d)
+			i += 1 + (x[i] & 0x1f);
+		if (i != d)
+			return EDID_ERR_CTA_DATA_BLOCKS;
+	}
+	if (!(flags & EDID_VALIDATE_CONFORMANCE))
+		return EDID_OK;
+
+	while (d + 18 <= 127 && (x[d] || x[d + 1]))
+		d += 18;
+	if (!edid_validate_zero(x + d, 127 - d))
+		return EDID_ERR_CTA_PADDING;
+	return EDID_OK;
+}
+
+constexpr edid_error edid_validate_displayid(const unsigned char *x, unsigned flags)
+{
+	unsigned len = x[2];
+
+	if (len > 121)
+		return EDID_ERR_DISPLAYID_LENGTH;
+
+	unsigned i = 5;
+
+	// Data Blocks are followed by 0 filler bytes, as is done by edid-decode
+	while (i + 3 <= 5 + len && (x[i] || x[i + 2])) {
+		i += 3 + x[i + 2];
+		if (i > 5 + len)
+			return EDID_ERR_DISPLAYID_DATA_BLOCKS;
+	}
+	if (!edid_validate_sum(x + 1, len + 5))
+		return EDID_ERR_DISPLAYID_CHECKSUM;
+	if ((flags & EDID_VALIDATE_CONFORMANCE) &&
+	    (!edid_validate_zero(x + i, 5 + len - i) ||
+	     !edid_validate_zero(x + 6 + len, 121 - len)))
+		return EDID_ERR_DISPLAYID_PADDING;
+	return EDID_OK;
+}
+
+// Validate the EDID, returns the first check that failed
+constexpr edid_error edid_validate(const unsigned char *edid, size_t size, unsigned flags = 0)
+{
+	const unsigned char header[8] = { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+
+	if (!size || size % 128 || size > 256 * 128)
+		return EDID_ERR_SIZE;
+	for (unsigned i = 0; i < 8; i++)
+		if (edid[i] != header[i])
+			return EDID_ERR_HEADER;
+	for (size_t b = 0; b < size; b += 128)
+		if (!edid_validate_sum(edid + b, 128))
+			return EDID_ERR_CHECKSUM;
+
+	unsigned blocks = size / 128;
+
+	if (edid[0x7e] + 1U != blocks && edid_validate_eeodb(edid, size) + 1 != blocks)
+		return EDID_ERR_EXT_COUNT;
+
+	edid_error err = edid_validate_base(edid, flags);
+
+	for (unsigned b = 1; b < blocks && err == EDID_OK; b++) {
+		const unsigned char *x = edid + b * 128;
+
+		if (x[0] == 0x02)
+			err = edid_validate_cta(x, flags);
+		else if (x[0] == 0x70)
+			err = edid_validate_displayid(x, flags);
+	}
+	return err;
+}
+
+template <size_t N>
+constexpr bool edid_valid(const unsigned char (&edid)[N], unsigned flags = 0)
+{
+	return edid_validate(edid, N, flags) == EDID_OK;
+}
+
+#else
+
+#define EDID_CONST const
+
+#endif
+
+#endif
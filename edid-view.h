@@ -0,0 +1,431 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Typed views over raw EDID bytes.
+ *
+ * A view is a pointer and a length into a caller-owned EDID buffer. Views
+ * never copy or allocate and never parse ahead: every field is extracted
+ * from the bytes when it is read. All reads are bounds-checked, reading
+ * beyond the end of a view returns 0. So a caller that only needs a few
+ * fields pays only for those fields, e.g.:
+ *
+ *	edid_view e(edid, size);
+ *	char pnp[4];
+ *
+ *	e.base().manufacturer(pnp);
+ *	for (auto blk : e.extensions()) {
+ *		cta_view cta(blk);
+ *
+ *		for (auto db : cta.data_blocks())
+ *			if (db.is_ext() && db.ext_tag() == 0x0e)
+ *				...
+ *	}
+ *
+ * Views do not validate the EDID: use edid-decode --check for that.
+ */
+
+#ifndef __EDID_VIEW_H_
+#define __EDID_VIEW_H_
+
+#include "edid-decode.h"
+
+// A bounds-checked range of bytes
+struct byte_view {
+	const unsigned char *p;
+	unsigned len;
+
+	byte_view(const unsigned char *p = NULL, unsigned len = 0) : p(p), len(p ? len : 0) {}
+
+	unsigned size() const { return len; }
+	bool empty() const { return !len; }
+	unsigned char operator[](unsigned i) const { return i < len ? p[i] : 0; }
+	// Little-endian 16 and 32 bit fields
+	unsigned le16(unsigned i) const { return (*this)[i] | ((*this)[i + 1] << 8); }
+	unsigned le32(unsigned i) const { return le16(i) | (le16(i + 2) << 16); }
+	// Big-endian 24 bit field, e.g. an OUI in a DisplayID block
+	unsigned be24(unsigned i) const { return ((*this)[i] << 16) | ((*this)[i + 1] << 8) | (*this)[i + 2]; }
+	// Little-endian 24 bit field, e.g. an OUI in a CTA-861 block
+	unsigned le24(unsigned i) const { return le16(i) | ((*this)[i + 2] << 16); }
+	byte_view sub(unsigned offset, unsigned n) const
+	{
+		if (offset >= len)
+			return byte_view();
+		return byte_view(p + offset, min(n, len - offset));
+	}
+	byte_view sub(unsigned offset) const { return sub(offset, len); }
+};
+
+/*
+ * A forward iterator over a sequence of variable length items, as found
+ * in CTA-861 Data Block Collections and DisplayID sections. V is the item
+ * view, V::item_size() returns the size of the item at the start of a
+ * byte_view, or 0 if it does not fit.
+ */
+template <class V>
+struct view_iterator {
+	byte_view rest;
+
+	view_iterator(byte_view rest = byte_view()) : rest(rest)
+	{
+		if (!V::item_size(rest))
+			this->rest = byte_view();
+	}
+	V operator*() const { return V(rest.sub(0, V::item_size(rest))); }
+	view_iterator &operator++()
+	{
+		*this = view_iterator(rest.sub(V::item_size(rest)));
+		return *this;
+	}
+	bool operator==(const view_iterator &other) const { return rest.p == other.rest.p; }
+	bool operator!=(const view_iterator &other) const { return rest.p != other.rest.p; }
+};
+
+template <class V>
+struct view_range {
+	byte_view bytes;
+
+	view_range(byte_view bytes) : bytes(bytes) {}
+	view_iterator<V> begin() const { return view_iterator<V>(bytes); }
+	view_iterator<V> end() const { return view_iterator<V>(); }
+};
+
+// An 18 byte Detailed Timing Descriptor or Display Descriptor
+struct descriptor_view {
+	byte_view x;
+
+	descriptor_view(byte_view x = byte_view()) : x(x.sub(0, 18)) {}
+	// An all zero descriptor ends a list of descriptors
+	static unsigned item_size(byte_view b) { return b.size() >= 18 && !memchk(b.p, 18) ? 18 : 0; }
+
+	bool is_dtd() const { return x[0] || x[1]; }
+	unsigned pixclk_khz() const { return x.le16(0) * 10; }
+	unsigned hact() const { return x[2] | ((x[4] & 0xf0) << 4); }
+	unsigned hblank() const { return x[3] | ((x[4] & 0x0f) << 8); }
+	unsigned vact() const { return x[5] | ((x[7] & 0xf0) << 4); }
+	unsigned vblank() const { return x[6] | ((x[7] & 0x0f) << 8); }
+	bool interlaced() const { return x[17] & 0x80; }
+	// The image size, 0 if unknown or an aspect ratio placeholder
+	unsigned hsize_mm() const { return x[12] | ((x[14] & 0xf0) << 4); }
+	unsigned vsize_mm() const { return x[13] | ((x[14] & 0x0f) << 8); }
+	// The Display Descriptor tag, 0 for a DTD
+	unsigned char tag() const { return is_dtd() ? 0 : x[3]; }
+	// The timings of a DTD, without the sync polarities and image size
+	timings dtd_timings() const
+	{
+		timings t = {};
+
+		t.pixclk_khz = pixclk_khz();
+		t.hact = hact();
+		t.hfp = x[8] | ((x[11] & 0xc0) << 2);
+		t.hsync = x[9] | ((x[11] & 0x30) << 4);
+		t.hbp = hblank() - t.hfp - t.hsync;
+		t.vact = vact();
+		t.vfp = (x[10] >> 4) | ((x[11] & 0x0c) << 2);
+		t.vsync = (x[10] & 0x0f) | ((x[11] & 0x03) << 4);
+		t.vbp = vblank() - t.vfp - t.vsync;
+		if (interlaced()) {
+			t.interlaced = true;
+			t.vact *= 2;
+		}
+		return t;
+	}
+	/*
+	 * Copy the string of a Display Product Name, Serial Number or
+	 * Alphanumeric Data String descriptor into s (at least 14 bytes)
+	 * without the terminating 0x0a and padding.
+	 */
+	const char *string(char *s) const
+	{
+		unsigned i;
+
+		for (i = 0; i < 13 && x[5 + i] != 0x0a && x[5 + i]; i++)
+			s[i] = x[5 + i];
+		s[i] = 0;
+		return s;
+	}
+};
+
+// The field rate of the timings in Hz, 0 if the totals are 0
+static inline double refresh_hz(const timings &t)
+{
+	unsigned htotal = t.hact + t.hfp + t.hsync + t.hbp + 2 * t.hborder;
+	double vtotal = (t.interlaced ? t.vact / 2 : t.vact) + t.vfp + t.vsync + t.vbp +
+		2 * t.vborder;
+
+	if (t.interlaced && !t.even_vtotal)
+		vtotal += 0.5;
+	return htotal && vtotal ? t.pixclk_khz * 1000.0 / (htotal * vtotal) : 0;
+}
+
+// Block 0
+struct base_block_view {
+	byte_view x;
+
+	base_block_view(byte_view x = byte_view()) : x(x.sub(0, EDID_PAGE_SIZE)) {}
+
+	bool has_header() const { return x.size() >= 8 && !memcmp(x.p, "\x00\xff\xff\xff\xff\xff\xff\x00", 8); }
+	// The three letter PNP ID, pnp must hold at least 4 bytes
+	const char *manufacturer(char *pnp) const
+	{
+		pnp[0] = ((x[8] & 0x7c) >> 2) + '@';
+		pnp[1] = ((x[8] & 0x03) << 3) + ((x[9] & 0xe0) >> 5) + '@';
+		pnp[2] = (x[9] & 0x1f) + '@';
+		pnp[3] = 0;
+		return pnp;
+	}
+	unsigned product() const { return x.le16(10); }
+	unsigned serial() const { return x.le32(12); }
+	unsigned week() const { return x[16]; }
+	unsigned year() const { return x[17] + 1990; }
+	unsigned version() const { return x[18]; }
+	unsigned revision() const { return x[19]; }
+	unsigned num_extensions() const { return x[0x7e]; }
+	descriptor_view descriptor(unsigned i) const
+	{
+		return i < 4 ? descriptor_view(x.sub(0x36 + i * 18, 18)) : descriptor_view();
+	}
+};
+
+// A 128 byte extension block
+struct block_view {
+	byte_view x;
+
+	block_view(byte_view x = byte_view()) : x(x) {}
+	block_view(const unsigned char *x) : x(x, EDID_PAGE_SIZE) {}
+	static unsigned item_size(byte_view b) { return b.size() >= EDID_PAGE_SIZE ? EDID_PAGE_SIZE : 0; }
+
+	unsigned char tag() const { return x[0]; }
+};
+
+// A CTA-861 Data Block, including its header byte(s)
+struct data_block_view {
+	byte_view x;
+
+	data_block_view(byte_view x = byte_view()) : x(x) {}
+	static unsigned item_size(byte_view b)
+	{
+		unsigned n = (b[0] & 0x1f) + 1;
+
+		return b.size() >= n ? n : 0;
+	}
+
+	unsigned tag() const { return x[0] >> 5; }
+	bool is_ext() const { return tag() == 0x07; }
+	// The extended tag of a tag 7 block, ~0U otherwise
+	unsigned ext_tag() const { return is_ext() && x.size() > 1 ? x[1] : ~0U; }
+	// The bytes after the tag (and extended tag)
+	byte_view payload() const { return x.sub(is_ext() ? 2 : 1); }
+	// The OUI of a (video or audio) vendor-specific block, 0 otherwise
+	unsigned oui() const
+	{
+		if (tag() == 0x03 && x.size() >= 4)
+			return x.le24(1);
+		if ((ext_tag() == 0x01 || ext_tag() == 0x11) && x.size() >= 5)
+			return x.le24(2);
+		return 0;
+	}
+};
+
+// The VIC of a Short Video Descriptor, VICs 1-64 can have the native bit set
+static inline unsigned char svd_vic(unsigned char svd)
+{
+	return (svd & 0x7f) <= 64 ? svd & 0x7f : svd;
+}
+
+// Short Video Descriptors
+struct svd_view {
+	byte_view x;
+
+	svd_view(data_block_view db) : x(db.tag() == 0x02 ? db.payload() : byte_view()) {}
+
+	unsigned count() const { return x.size(); }
+	unsigned char vic(unsigned i) const { return svd_vic(x[i]); }
+	bool native(unsigned i) const { return (x[i] & 0x7f) <= 64 && (x[i] & 0x80); }
+};
+
+// YCbCr 4:2:0 Video Data Block, the SVDs of the 4:2:0 only formats
+struct y420vdb_view {
+	byte_view x;
+
+	y420vdb_view(data_block_view db) : x(db.ext_tag() == 0x0e ? db.payload() : byte_view()) {}
+
+	unsigned count() const { return x.size(); }
+	unsigned char vic(unsigned i) const { return svd_vic(x[i]); }
+};
+
+/*
+ * YCbCr 4:2:0 Capability Map Data Block. Bit i refers to SVD i of all
+ * Video Data Blocks, an empty map means all SVDs.
+ */
+struct cmdb_view {
+	byte_view x;
+	bool present;
+
+	cmdb_view(data_block_view db = data_block_view()) :
+		x(db.ext_tag() == 0x0f ? db.payload() : byte_view()),
+		present(db.ext_tag() == 0x0f) {}
+
+	bool valid() const { return present; }
+	bool ycbcr420(unsigned svd) const
+	{
+		return present && (x.empty() || (x[svd / 8] & (1 << (svd % 8))));
+	}
+};
+
+// Short Audio Descriptors
+struct sad_view {
+	byte_view x;
+
+	sad_view(data_block_view db) : x(db.tag() == 0x01 ? db.payload() : byte_view()) {}
+
+	unsigned count() const { return x.size() / 3; }
+	unsigned format(unsigned i) const { return (x[i * 3] & 0x78) >> 3; }
+	unsigned channels(unsigned i) const { return (x[i * 3] & 0x07) + 1; }
+	// Bit mask of 32, 44.1, 48, 88.2, 96, 176.4 and 192 kHz
+	unsigned char sample_rates(unsigned i) const { return x[i * 3 + 1] & 0x7f; }
+};
+
+// HDMI Vendor-Specific Data Block (HDMI 1.4b)
+struct hdmi_vsdb_view {
+	byte_view x;
+
+	hdmi_vsdb_view(data_block_view db) : x(db.oui() == 0x000c03 ? db.payload() : byte_view()) {}
+
+	bool valid() const { return x.size() >= 5; }
+	unsigned phys_addr() const { return (x[3] << 8) | x[4]; }
+	bool supports_ai() const { return x[5] & 0x80; }
+	// Bit mask of 48 (0x40), 36 (0x20) and 30 (0x10) bits per pixel
+	unsigned char deep_color() const { return x[5] & 0x70; }
+	bool dc_y444() const { return x[5] & 0x08; }
+	// 0 if not present
+	unsigned max_tmds_mhz() const { return x[6] * 5; }
+};
+
+// The maximum FRL rate in Gbps of a Max_FRL_Rate value, 0 if reserved
+static inline unsigned frl_gbps(unsigned max_frl)
+{
+	static const unsigned char gbps[] = { 0, 9, 18, 24, 32, 40, 48 };
+
+	return max_frl < ARRAY_SIZE(gbps) ? gbps[max_frl] : 0;
+}
+
+// HDMI Forum Vendor-Specific Data Block and Sink Capability Data Block
+struct hf_scdb_view {
+	byte_view x;
+
+	hf_scdb_view(data_block_view db)
+	{
+		if (db.oui() == 0xc45dd8)
+			x = db.payload().sub(3);
+		else if (db.ext_tag() == 0x79)
+			x = db.payload().sub(2);
+	}
+
+	bool valid() const { return x.size() >= 4; }
+	unsigned version() const { return x[0]; }
+	// 0 if not above 340 MHz
+	unsigned max_tmds_mhz() const { return x[1] * 5; }
+	bool scdc_present() const { return x[2] & 0x80; }
+	unsigned max_frl() const { return x[3] >> 4; }
+	unsigned max_frl_gbps() const { return frl_gbps(max_frl()); }
+	// Bit mask of 48 (0x04), 36 (0x02) and 30 (0x01) bits per pixel
+	unsigned char dc_420() const { return x[3] & 0x07; }
+};
+
+// HDR Static Metadata Data Block
+struct hdr_static_view {
+	byte_view x;
+
+	hdr_static_view(data_block_view db) : x(db.ext_tag() == 0x06 ? db.payload() : byte_view()) {}
+
+	bool valid() const { return x.size() >= 2; }
+	// Bit mask of SDR (0x01), HDR (0x02), SMPTE ST2084 (0x04) and HLG (0x08)
+	unsigned char eotfs() const { return x[0] & 0x3f; }
+	unsigned char metadata_types() const { return x[1]; }
+	// The raw luminance codes, 0 if not present
+	unsigned char max_lum() const { return x[2]; }
+	unsigned char max_frame_avg_lum() const { return x[3]; }
+	unsigned char min_lum() const { return x[4]; }
+};
+
+// CTA-861 Extension Block
+struct cta_view {
+	byte_view x;
+
+	cta_view(block_view blk) : x(blk.tag() == 0x02 ? blk.x : byte_view()) {}
+	cta_view(const unsigned char *x) : cta_view(block_view(x)) {}
+
+	bool valid() const { return x.size() == EDID_PAGE_SIZE; }
+	unsigned revision() const { return x[1]; }
+	// Offset of the first DTD
+	unsigned dtd_offset() const { return x[2] < 4 || x[2] > 127 ? 4 : x[2]; }
+	bool underscan() const { return x[3] & 0x80; }
+	bool basic_audio() const { return x[3] & 0x40; }
+	bool ycbcr444() const { return x[3] & 0x20; }
+	bool ycbcr422() const { return x[3] & 0x10; }
+	unsigned native_dtds() const { return x[3] & 0x0f; }
+	view_range<data_block_view> data_blocks() const
+	{
+		return revision() >= 3 ? x.sub(4, dtd_offset() - 4) : byte_view();
+	}
+	view_range<descriptor_view> dtds() const
+	{
+		return x.sub(dtd_offset(), 127 - dtd_offset());
+	}
+};
+
+// A DisplayID Data Block, including its 3 byte header
+struct displayid_block_view {
+	byte_view x;
+
+	displayid_block_view(byte_view x = byte_view()) : x(x) {}
+	static unsigned item_size(byte_view b)
+	{
+		unsigned n = b[2] + 3;
+
+		// A zero tag starts the padding
+		return b.size() >= n && b[0] ? n : 0;
+	}
+
+	unsigned tag() const { return x[0]; }
+	unsigned revision() const { return x[1] & 0x07; }
+	byte_view payload() const { return x.sub(3); }
+};
+
+// The DisplayID section of a DisplayID Extension Block
+struct displayid_view {
+	byte_view x;
+
+	displayid_view(block_view blk) : x(blk.tag() == 0x70 ? blk.x.sub(1, 126) : byte_view()) {}
+	displayid_view(const unsigned char *x) : displayid_view(block_view(x)) {}
+
+	bool valid() const { return x.size() >= 5 && x[1] <= 121; }
+	unsigned version() const { return x[0]; }
+	unsigned product_type() const { return x[2]; }
+	unsigned num_extensions() const { return x[3]; }
+	view_range<displayid_block_view> data_blocks() const
+	{
+		return x.sub(4, x[1]);
+	}
+};
+
+// A complete EDID
+struct edid_view {
+	byte_view x;
+
+	edid_view(const unsigned char *edid, unsigned size) : x(edid, size) {}
+
+	base_block_view base() const { return x; }
+	unsigned num_blocks() const { return min(x.size() / EDID_PAGE_SIZE, base().num_extensions() + 1); }
+	block_view block(unsigned i) const
+	{
+		return i < num_blocks() ? x.sub(i * EDID_PAGE_SIZE, EDID_PAGE_SIZE) : byte_view();
+	}
+	view_range<block_view> extensions() const
+	{
+		if (!num_blocks())
+			return byte_view();
+		return x.sub(EDID_PAGE_SIZE, (num_blocks() - 1) * EDID_PAGE_SIZE);
+	}
+};
+
+#endif
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Fix mechanical conformance failures in an EDID.
+ *
+ * Only failures with a single unambiguous correction are fixed: the
+ * intent of the EDID is never guessed.
+ */
+
+#include "edid-view.h"
+
+const char * const fix_names[] = {
+	"checksum",
+	"std-timing",
+	"string-padding",
+	"cta-padding",
+	"cta-byte3",
+	"block-map",
+	"vcdb",
+	nullptr
+};
+
+static unsigned char calc_checksum(const unsigned char *x)
+{
+	unsigned char sum = 0;
+
+	for (unsigned i = 0; i < EDID_PAGE_SIZE - 1; i++)
+		sum += x[i];
+	return -sum;
+}
+
+// Use 0x0101 as the code for unused Standard Timings
+static bool fix_std_timings(unsigned char *x, unsigned cnt)
+{
+	bool fixed = false;
+
+	for (unsigned i = 0; i < cnt; i++, x += 2) {
+		if (x[0] <= 0x01 && (x[0] != 0x01 || x[1] != 0x01)) {
+			x[0] = x[1] = 0x01;
+			fixed = true;
+		}
+	}
+	return fixed;
+}
+
+/*
+ * Terminate a descriptor string with 0x0a and pad it with spaces,
+ * dropping any trailing spaces of the string itself.
+ */
+static bool fix_string(unsigned char *s, unsigned len)
+{
+	unsigned char fixed[13];
+	unsigned n, i;
+
+	for (n = 0; n < len && s[n] != 0x0a && s[n]; n++)
+		if (s[n] < 0x20 || s[n] > 0x7e)
+			return false;
+	// Anything but padding after the string is not a mechanical fix
+	for (i = n; i < len; i++)
+		if (s[i] && s[i] != 0x0a && s[i] != 0x20)
+			return false;
+	while (n && s[n - 1] == 0x20)
+		n--;
+	if (!n)
+		return false;
+
+	memcpy(fixed, s, n);
+	for (i = n; i < len; i++)
+		fixed[i] = i == n ? 0x0a : 0x20;
+	if (!memcmp(fixed, s, len))
+		return false;
+	memcpy(s, fixed, len);
+	return true;
+}
+
+static unsigned fix_base_block(unsigned char *x, unsigned fixes)
+{
+	unsigned applied = 0;
+
+	if ((fixes & FIX_STD_TIMING) && fix_std_timings(x + 0x26, 8))
+		applied |= FIX_STD_TIMING;
+
+	for (unsigned i = 0x36; i < 0x7e; i += 18) {
+		unsigned char *d = x + i;
+
+		if (d[0] || d[1] || d[2] || d[4])
+			continue;
+		if ((fixes & FIX_STD_TIMING) && d[3] == 0xfa &&
+		    fix_std_timings(d + 5, 6))
+			applied |= FIX_STD_TIMING;
+		if ((fixes & FIX_STRING_PADDING) &&
+		    (d[3] == 0xfc || d[3] == 0xfe || d[3] == 0xff) &&
+		    fix_string(d + 5, 13))
+			applied |= FIX_STRING_PADDING;
+	}
+	return applied;
+}
+
+static bool cta_has_vcdb(const unsigned char *x)
+{
+	for (auto db : cta_view(x).data_blocks())
+		if (db.ext_tag() == 0x00)
+			return true;
+	return false;
+}
+
+// Returns the offset just after the last DTD
+static unsigned cta_dtds_end(const unsigned char *x)
+{
+	cta_view cta(x);
+	unsigned end = cta.dtd_offset();
+
+	for (auto dtd : cta.dtds())
+		end += dtd.x.size();
+	return end;
+}
+
+static unsigned fix_cta_block(unsigned char *x, unsigned fixes, unsigned char byte3)
+{
+	unsigned applied = 0;
+
+	if (x[2] < 4 || x[2] > 127)
+		return 0;
+
+	if ((fixes & FIX_CTA_BYTE3) && x[1] >= 2 && x[3] != byte3) {
+		x[3] = byte3;
+		applied |= FIX_CTA_BYTE3;
+	}
+
+	unsigned end = cta_dtds_end(x);
+
+	if ((fixes & FIX_CTA_PADDING) && !memchk(x + end, 127 - end)) {
+		memset(x + end, 0, 127 - end);
+		applied |= FIX_CTA_PADDING;
+	}
+	return applied;
+}
+
+// The Data Block Collection must end exactly at the DTD offset
+static bool cta_dbc_ok(const unsigned char *x)
+{
+	unsigned i = 4;
+
+	while (i < x[2])
+		i += (x[i] & 0x1f) + 1;
+	return i == x[2];
+}
+
+/*
+ * Add a VCDB with selectable RGB quantization (and YCbCr quantization
+ * if YCbCr is supported) at the start of the Data Block Collection.
+ * A DTD offset of 0 means there are no DTDs and no Data Block
+ * Collection, so the collection starts at byte 4.
+ */
+static bool add_vcdb(unsigned char *x)
+{
+	unsigned char orig[EDID_PAGE_SIZE];
+	unsigned end;
+
+	if (x[1] < 3 || (x[2] && (x[2] < 4 || x[2] > 127)))
+		return false;
+	memcpy(orig, x, EDID_PAGE_SIZE);
+	if (!x[2])
+		x[2] = 4;
+	end = cta_dtds_end(x);
+	if (end + 3 > 127 || !memchk(x + end, 127 - end)) {
+		memcpy(x, orig, EDID_PAGE_SIZE);
+		return false;
+	}
+	memmove(x + 7, x + 4, end - 4);
+	x[4] = 0xe2;
+	x[5] = 0x00;
+	x[6] = (x[3] & 0x30) ? 0xc0 : 0x40;
+	x[2] += 3;
+	// Only report the fix if the result parses as intended
+	if (!cta_dbc_ok(x) || !cta_has_vcdb(x)) {
+		memcpy(x, orig, EDID_PAGE_SIZE);
+		return false;
+	}
+	return true;
+}
+
+static unsigned fix_block_map(unsigned char *x, const unsigned char *edid,
+			      unsigned num_blocks, unsigned offset)
+{
+	bool fixed = false;
+
+	for (unsigned i = 1; i < 127; i++) {
+		unsigned block = offset + i;
+		unsigned char tag = block < num_blocks ? edid[block * EDID_PAGE_SIZE] : 0;
+
+		if (x[i] != tag) {
+			x[i] = tag;
+			fixed = true;
+		}
+	}
+	return fixed ? FIX_BLOCK_MAP : 0;
+}
+
+/*
+ * Apply the selected fixes (a mask of FIX_ flags) to the EDID in place.
+ * The checksum of every block that is changed is updated. Returns the
+ * mask of the fixes that were applied.
+ */
+unsigned fix_edid(unsigned char *edid, unsigned num_blocks, unsigned fixes)
+{
+	unsigned char orig[EDID_PAGE_SIZE * EDID_MAX_BLOCKS];
+	unsigned size = num_blocks * EDID_PAGE_SIZE;
+	unsigned char *first_cta = NULL;
+	bool has_vcdb = false;
+	unsigned applied;
+
+	memcpy(orig, edid, size);
+	applied = fix_base_block(edid, fixes);
+
+	for (unsigned i = 1; i < num_blocks; i++) {
+		unsigned char *x = edid + i * EDID_PAGE_SIZE;
+
+		switch (x[0]) {
+		case 0x02:
+			if (!first_cta)
+				first_cta = x;
+			applied |= fix_cta_block(x, fixes, first_cta[3]);
+			has_vcdb |= cta_has_vcdb(x);
+			break;
+		case 0xf0:
+			if ((fixes & FIX_BLOCK_MAP) && (i == 1 || i == 128))
+				applied |= fix_block_map(x, edid, num_blocks, i == 1 ? 1 : 128);
+			break;
+		}
+	}
+	if ((fixes & FIX_VCDB) && first_cta && !has_vcdb && add_vcdb(first_cta))
+		applied |= FIX_VCDB;
+
+	for (unsigned i = 0; i < num_blocks; i++) {
+		unsigned char *x = edid + i * EDID_PAGE_SIZE;
+		const unsigned char *o = orig + i * EDID_PAGE_SIZE;
+		bool changed = memcmp(x, o, EDID_PAGE_SIZE - 1);
+
+		if (o[EDID_PAGE_SIZE - 1] == calc_checksum(o)) {
+			if (changed)
+				x[EDID_PAGE_SIZE - 1] = calc_checksum(x);
+		} else if (fixes & FIX_CHECKSUM) {
+			x[EDID_PAGE_SIZE - 1] = calc_checksum(x);
+			applied |= FIX_CHECKSUM;
+		}
+	}
+	return applied;
+}
+
+std::string fixes2s(unsigned fixes)
+{
+	std::string s;
+
+	for (unsigned i = 0; fix_names[i]; i++) {
+		if (!(fixes & (1U << i)))
+			continue;
+		if (!s.empty())
+			s += ", ";
+		s += fix_names[i];
+	}
+	return s.empty() ? "none" : s;
+}
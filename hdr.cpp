@@ -0,0 +1,569 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Negotiate the HDR format of each mode.
+ *
+ * The HDR capabilities of a sink are spread over the HDR Static Metadata
+ * Data Block (the EOTFs and the desired content luminance), the HDR
+ * Dynamic Metadata Data Block, the Dolby Vision and HDR10+ Vendor-Specific
+ * Video Data Blocks, the Colorimetry Data Block, the FreeSync HDR fields of
+ * the AMD VSDB and the DisplayID Display Interface Features Data Block.
+ * hdr_sink_caps() combines these, reading the EDID through the
+ * edid-view.h views without decoding it.
+ *
+ * hdr_negotiate() then picks for a mode the best HDR format that both the
+ * source and the sink support, in the order Dolby Vision, Dolby Vision
+ * low-latency, HDR10+, HDR10, FreeSync HDR and HLG, and falls back to SDR.
+ * A format is only picked if the sink accepts a pixel encoding with the
+ * bit depth and colorimetry the format needs at a TMDS character rate or
+ * FRL rate the sink supports. The result includes the EOTF, colorimetry,
+ * pixel encoding and the luminance range to tone map to.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "edid-view.h"
+
+static const struct {
+	unsigned format;
+	const char *name;
+	const char *option;
+} hdr_format_names[] = {
+	{ HDR_DOLBY_VISION, "Dolby Vision", "dolby-vision" },
+	{ HDR_DOLBY_VISION_LL, "Dolby Vision low-latency", "dolby-vision-ll" },
+	{ HDR_HDR10_PLUS, "HDR10+", "hdr10plus" },
+	{ HDR_HDR10, "HDR10", "hdr10" },
+	{ HDR_FREESYNC, "FreeSync HDR", "freesync-hdr" },
+	{ HDR_HLG, "HLG", "hlg" },
+};
+
+static const char *encoding_names[] = {
+	"RGB", "YCbCr 4:4:4", "YCbCr 4:2:2", "YCbCr 4:2:0",
+};
+
+std::string hdr_formats2s(unsigned formats)
+{
+	std::string s;
+
+	for (const auto &f : hdr_format_names)
+		if (formats & f.format)
+			s += (s.empty() ? "" : ", ") + std::string(f.name);
+	return s.empty() ? "SDR" : s;
+}
+
+unsigned hdr_parse_format(const char *option)
+{
+	if (!strcmp(option, "all"))
+		return HDR_ALL;
+	for (const auto &f : hdr_format_names)
+		if (!strcmp(option, f.option))
+			return f.format;
+	return 0;
+}
+
+// A 12 bit SMPTE ST 2084 code in cd/m^2
+static double pq2nits(unsigned code)
+{
+	const double m1 = 2610.0 / 16384, m2 = 2523.0 / 4096 * 128;
+	const double c1 = 3424.0 / 4096, c2 = 2413.0 / 4096 * 32, c3 = 2392.0 / 4096 * 32;
+	double e = pow(code / 4095.0, 1 / m2);
+
+	return 10000 * pow(max(e - c1, 0.0) / (c2 - c3 * e), 1 / m1);
+}
+
+// The luminance codes of the HDR Static Metadata and AMD VSDB
+static double max_lum2nits(unsigned char max_lum)
+{
+	return 50.0 * pow(2, max_lum / 32.0);
+}
+
+static double min_lum2nits(unsigned char max_lum, unsigned char min_lum)
+{
+	return max_lum2nits(max_lum) * pow(min_lum / 255.0, 2) / 100.0;
+}
+
+// The highest bit depth of a DisplayID bpc bit mask, bit 0 is first_bpc
+static unsigned max_bpc(unsigned char mask, unsigned first_bpc)
+{
+	unsigned bpc = 0;
+
+	for (unsigned i = 0; i < 6; i++)
+		if (mask & (1 << i))
+			bpc = first_bpc + 2 * i;
+	return bpc;
+}
+
+// The Dolby Vision VSVDB, x is the payload after the OUI
+static void parse_dolby_vision(hdr_caps &caps, byte_view x)
+{
+	unsigned version = (x[0] >> 5) & 0x07;
+
+	caps.dv_version = version;
+	caps.dv_yuv422_12b = x[0] & 0x01;
+	switch (version) {
+	case 0:
+		caps.formats |= HDR_DOLBY_VISION;
+		caps.dv_2160p60 = x[0] & 0x02;
+		caps.dv_colorimetry = "Dolby Vision sink primaries";
+		caps.dv_min_lum = pq2nits((x[14] << 4) | (x[13] >> 4));
+		caps.dv_max_lum = pq2nits((x[15] << 4) | (x[13] & 0x0f));
+		break;
+	case 1:
+		caps.formats |= HDR_DOLBY_VISION;
+		if (x[3] & 0x01)
+			caps.formats |= HDR_DOLBY_VISION_LL;
+		caps.dv_2160p60 = x[0] & 0x02;
+		caps.dv_colorimetry = (x[2] & 0x01) ? "P3-D65" : "BT.709";
+		caps.dv_min_lum = pow((x[2] >> 1) / 127.0, 2);
+		caps.dv_max_lum = 100 + (x[1] >> 1) * 50;
+		break;
+	case 2:
+		caps.formats |= HDR_DOLBY_VISION_LL;
+		if (x[2] & 0x02)
+			caps.formats |= HDR_DOLBY_VISION;
+		caps.dv_2160p60 = true;
+		caps.dv_colorimetry = "Dolby Vision sink primaries";
+		switch (((x[3] & 0x01) << 1) | (x[4] & 0x01)) {
+		case 1: caps.dv_444_bpc = 10; break;
+		case 2: caps.dv_444_bpc = 12; break;
+		}
+		caps.dv_min_lum = pq2nits(20 * (x[1] >> 3));
+		caps.dv_max_lum = pq2nits(2055 + 65 * (x[2] >> 3));
+		break;
+	}
+}
+
+// The HDR Dynamic Metadata Data Block
+static void parse_dyn_metadata(hdr_caps &caps, byte_view x)
+{
+	for (unsigned i = 0; i + 3 <= x.size() && x[i] >= 2; i += x[i] + 1) {
+		unsigned type = x.le16(i + 1);
+
+		if (type < 32)
+			caps.dyn_metadata_types |= 1U << type;
+	}
+}
+
+// The Display Interface Features Data Block
+static void parse_interface_features(hdr_caps &caps, byte_view x)
+{
+	if (x.size() < 9)
+		return;
+	if (max_bpc(x[0], 6))
+		caps.max_bpc[HDR_RGB] = max_bpc(x[0], 6);
+	if (max_bpc(x[1], 6))
+		caps.max_bpc[HDR_YCBCR444] = max_bpc(x[1], 6);
+	if (max_bpc(x[2], 8))
+		caps.max_bpc[HDR_YCBCR422] = max_bpc(x[2], 8);
+	// BT.2020/SMPTE ST 2084
+	if (x[6] & 0x40) {
+		caps.eotfs |= 0x04;
+		caps.bt2020_rgb = true;
+	}
+	for (unsigned i = 0; i < x[8] && 9 + i < x.size(); i++) {
+		unsigned colorspace = x[9 + i] >> 4;
+		unsigned eotf = x[9 + i] & 0x0f;
+
+		if (colorspace != 6)
+			continue;
+		caps.bt2020_rgb = true;
+		if (eotf == 8)
+			caps.eotfs |= 0x04;
+		else if (eotf == 9)
+			caps.eotfs |= 0x08;
+	}
+}
+
+static void parse_cta(hdr_caps &caps, cta_view cta, std::vector<unsigned char> &svds,
+		      std::vector<cmdb_view> &cmdbs)
+{
+	if (cta.ycbcr444())
+		caps.max_bpc[HDR_YCBCR444] = max(caps.max_bpc[HDR_YCBCR444], 8U);
+	if (cta.ycbcr422())
+		caps.max_bpc[HDR_YCBCR422] = max(caps.max_bpc[HDR_YCBCR422], 8U);
+
+	for (auto db : cta.data_blocks()) {
+		byte_view p = db.payload();
+		hdmi_vsdb_view hdmi(db);
+		hf_scdb_view hf(db);
+		hdr_static_view hdr(db);
+
+		if (hdmi.valid()) {
+			caps.has_hdmi = true;
+			caps.max_tmds_mhz = max(caps.max_tmds_mhz, hdmi.max_tmds_mhz());
+			if (hdmi.deep_color()) {
+				unsigned bpc = (hdmi.deep_color() & 0x40) ? 16 :
+					(hdmi.deep_color() & 0x20) ? 12 : 10;
+
+				caps.max_bpc[HDR_RGB] = bpc;
+				if (hdmi.dc_y444())
+					caps.max_bpc[HDR_YCBCR444] = bpc;
+			}
+		}
+		if (hf.valid()) {
+			caps.max_tmds_mhz = max(caps.max_tmds_mhz, hf.max_tmds_mhz());
+			caps.max_frl_gbps = hf.max_frl_gbps();
+			caps.max_bpc[HDR_YCBCR420] = (hf.dc_420() & 0x04) ? 16 :
+				(hf.dc_420() & 0x02) ? 12 : (hf.dc_420() & 0x01) ? 10 : 8;
+		}
+		if (hdr.valid()) {
+			caps.eotfs |= hdr.eotfs();
+			caps.metadata_types |= hdr.metadata_types();
+			if (hdr.max_lum())
+				caps.max_lum = max_lum2nits(hdr.max_lum());
+			if (hdr.max_frame_avg_lum())
+				caps.max_fall = max_lum2nits(hdr.max_frame_avg_lum());
+			if (hdr.min_lum())
+				caps.min_lum = min_lum2nits(hdr.max_lum(), hdr.min_lum());
+		}
+		// Both are Vendor-Specific Video Data Blocks
+		if (db.oui() == 0x00d046 && db.ext_tag() == 0x01)
+			parse_dolby_vision(caps, p.sub(3));
+		if (db.oui() == 0x90848b && db.ext_tag() == 0x01) {
+			caps.formats |= HDR_HDR10_PLUS;
+			caps.hdr10plus_version = p[3] & 0x03;
+		}
+		// FreeSync 2 and later have the HDR luminance fields
+		if (db.oui() == 0x00001a && p.size() >= 13) {
+			caps.formats |= HDR_FREESYNC;
+			caps.fs_max_lum = max_lum2nits(p[9]);
+			caps.fs_min_lum = min_lum2nits(p[9], p[10]);
+		}
+
+		switch (db.tag()) {
+		case 0x02:
+			for (unsigned i = 0; i < p.size(); i++)
+				svds.push_back(svd_view(db).vic(i));
+			break;
+		}
+
+		switch (db.ext_tag()) {
+		case 0x05:
+			caps.bt2020_ycc |= p[0] & 0x40;
+			caps.bt2020_rgb |= p[0] & 0x80;
+			caps.dci_p3 |= p[1] & 0x80;
+			break;
+		case 0x07:
+			parse_dyn_metadata(caps, p);
+			break;
+		case 0x0e:
+			for (unsigned i = 0; i < y420vdb_view(db).count(); i++) {
+				unsigned char vic = y420vdb_view(db).vic(i);
+
+				caps.ycbcr420_only[vic] = caps.ycbcr420[vic] = true;
+			}
+			break;
+		case 0x0f:
+			cmdbs.push_back(cmdb_view(db));
+			break;
+		}
+	}
+}
+
+hdr_caps hdr_sink_caps(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	byte_view base = e.base().x;
+	std::vector<unsigned char> svds;
+	std::vector<cmdb_view> cmdbs;
+	hdr_caps caps;
+
+	caps.max_bpc[HDR_RGB] = 8;
+	// The bit depth of an EDID 1.4 digital input
+	if (e.base().revision() >= 4 && (base[0x14] & 0x80) &&
+	    (base[0x14] & 0x70) && (base[0x14] & 0x70) != 0x70)
+		caps.max_bpc[HDR_RGB] = ((base[0x14] & 0x70) >> 3) + 4;
+
+	for (auto blk : e.extensions()) {
+		cta_view cta(blk);
+		displayid_view displayid(blk);
+
+		if (cta.valid())
+			parse_cta(caps, cta, svds, cmdbs);
+		if (displayid.valid())
+			for (auto db : displayid.data_blocks())
+				if (db.tag() == 0x26)
+					parse_interface_features(caps, db.payload());
+	}
+	// The YCbCr 4:2:0 Capability Map refers to the SVDs of all Video Data Blocks
+	for (auto cmdb : cmdbs)
+		for (unsigned i = 0; i < svds.size(); i++)
+			if (cmdb.ycbcr420(i))
+				caps.ycbcr420[svds[i]] = true;
+	if (caps.has_hdmi) {
+		// HDMI sinks accept up to 12 bits for YCbCr 4:2:2
+		if (caps.max_bpc[HDR_YCBCR422])
+			caps.max_bpc[HDR_YCBCR422] = 12;
+		// 0 means not indicated, every HDMI sink supports 165 MHz
+		if (!caps.max_tmds_mhz)
+			caps.max_tmds_mhz = 165;
+	}
+	if (!caps.max_bpc[HDR_YCBCR420])
+		caps.max_bpc[HDR_YCBCR420] = 8;
+
+	// HDR10 needs SMPTE ST2084 with Static Metadata Type 1
+	if ((caps.eotfs & 0x04) && ((caps.metadata_types & 0x01) || !caps.metadata_types))
+		caps.formats |= HDR_HDR10;
+	if (caps.eotfs & 0x08)
+		caps.formats |= HDR_HLG;
+	// HDR Dynamic Metadata Type 4 is SMPTE ST 2094-40, i.e. HDR10+
+	if (caps.dyn_metadata_types & (1 << 4))
+		caps.formats |= HDR_HDR10_PLUS;
+	// HDR10+ is HDR10 with dynamic metadata
+	if (!(caps.formats & HDR_HDR10))
+		caps.formats &= ~HDR_HDR10_PLUS;
+	return caps;
+}
+
+static bool fits_link(const hdr_caps &caps, const hdr_mode &m, hdr_encoding enc, unsigned bpc)
+{
+	// Only HDMI sinks give a link limit
+	if (!caps.has_hdmi)
+		return true;
+
+	double mhz = m.pixclk_khz / 1000.0;
+	double tmds_mhz = mhz * bpc / 8;
+	double bits_per_pixel = 3.0 * bpc;
+
+	switch (enc) {
+	case HDR_YCBCR422:
+		// Always carried in a 24 bit container
+		tmds_mhz = mhz;
+		bits_per_pixel = 24;
+		break;
+	case HDR_YCBCR420:
+		tmds_mhz /= 2;
+		bits_per_pixel /= 2;
+		break;
+	default:
+		break;
+	}
+	if (tmds_mhz <= caps.max_tmds_mhz)
+		return true;
+	// FRL uses 16b/18b encoding
+	return mhz * bits_per_pixel <= caps.max_frl_gbps * 1000.0 * 16 / 18;
+}
+
+// Whether the sink accepts the pixel encoding for the mode
+static bool has_encoding(const hdr_caps &caps, const hdr_mode &m, hdr_encoding enc)
+{
+	if (enc == HDR_YCBCR420)
+		return m.vic && caps.ycbcr420[m.vic];
+	if (m.vic && caps.ycbcr420_only[m.vic])
+		return false;
+	return caps.max_bpc[enc];
+}
+
+// Pick the first pixel encoding of a format that has the bit depth and fits the link
+static bool pick_encoding(const hdr_caps &caps, hdr_mode &m, unsigned min_bpc,
+			  bool need_bt2020)
+{
+	for (unsigned i = HDR_RGB; i <= HDR_YCBCR420; i++) {
+		hdr_encoding enc = (hdr_encoding)i;
+		unsigned bpc = enc == HDR_YCBCR422 ? 12 : min_bpc;
+
+		if (!has_encoding(caps, m, enc) || caps.max_bpc[enc] < bpc)
+			continue;
+		if (need_bt2020 && !(enc == HDR_RGB ? caps.bt2020_rgb : caps.bt2020_ycc))
+			continue;
+		if (!fits_link(caps, m, enc, bpc))
+			continue;
+		m.encoding = enc;
+		m.bpc = bpc;
+		if (need_bt2020)
+			m.colorimetry = enc == HDR_RGB ? "BT.2020 RGB" : "BT.2020 YCbCr";
+		return true;
+	}
+	return false;
+}
+
+static bool try_format(const hdr_caps &caps, hdr_mode &m, unsigned format)
+{
+	switch (format) {
+	case HDR_DOLBY_VISION:
+		// Tunneled in 8 bit RGB
+		if (!caps.dv_2160p60 && m.vact >= 2160 && m.refresh > 30.5)
+			return false;
+		if (!has_encoding(caps, m, HDR_RGB) || !fits_link(caps, m, HDR_RGB, 8))
+			return false;
+		m.encoding = HDR_RGB;
+		m.bpc = 8;
+		break;
+	case HDR_DOLBY_VISION_LL:
+		if (!caps.dv_2160p60 && m.vact >= 2160 && m.refresh > 30.5)
+			return false;
+		if (caps.dv_yuv422_12b && has_encoding(caps, m, HDR_YCBCR422) &&
+		    fits_link(caps, m, HDR_YCBCR422, 12)) {
+			m.encoding = HDR_YCBCR422;
+			m.bpc = 12;
+		} else if (caps.dv_444_bpc && has_encoding(caps, m, HDR_RGB) &&
+			   fits_link(caps, m, HDR_RGB, caps.dv_444_bpc)) {
+			m.encoding = HDR_RGB;
+			m.bpc = caps.dv_444_bpc;
+		} else {
+			return false;
+		}
+		break;
+	case HDR_HDR10_PLUS:
+	case HDR_HDR10:
+	case HDR_HLG:
+		if (!pick_encoding(caps, m, 10, true))
+			return false;
+		break;
+	case HDR_FREESYNC:
+		if (!pick_encoding(caps, m, min(caps.max_bpc[HDR_RGB], 10U), false) ||
+		    m.encoding != HDR_RGB)
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	m.format = format;
+	switch (format) {
+	case HDR_DOLBY_VISION:
+	case HDR_DOLBY_VISION_LL:
+		m.eotf = "SMPTE ST2084";
+		m.colorimetry = caps.dv_colorimetry;
+		m.min_lum = caps.dv_min_lum;
+		m.max_lum = caps.dv_max_lum;
+		m.max_fall = 0;
+		break;
+	case HDR_FREESYNC:
+		m.eotf = "Gamma 2.2";
+		m.colorimetry = "native";
+		m.min_lum = caps.fs_min_lum;
+		m.max_lum = caps.fs_max_lum;
+		m.max_fall = 0;
+		break;
+	default:
+		m.eotf = format == HDR_HLG ? "Hybrid Log-Gamma" : "SMPTE ST2084";
+		m.min_lum = caps.min_lum;
+		m.max_lum = caps.max_lum;
+		m.max_fall = caps.max_fall;
+		break;
+	}
+	return true;
+}
+
+void hdr_negotiate(const hdr_caps &caps, unsigned source_formats, hdr_mode &m)
+{
+	for (const auto &f : hdr_format_names)
+		if ((source_formats & caps.formats & f.format) && try_format(caps, m, f.format))
+			return;
+
+	m.format = 0;
+	m.encoding = has_encoding(caps, m, HDR_RGB) ? HDR_RGB : HDR_YCBCR420;
+	m.bpc = 8;
+	m.eotf = "Traditional gamma - SDR luminance range";
+	m.colorimetry = "default";
+	m.min_lum = m.max_lum = m.max_fall = 0;
+}
+
+static hdr_mode make_mode(const std::string &source, unsigned char vic, const timings &t)
+{
+	hdr_mode m = {};
+
+	m.source = source;
+	m.vic = vic;
+	m.hact = t.hact;
+	m.vact = t.vact;
+	m.interlaced = t.interlaced;
+	m.refresh = refresh_hz(t);
+	m.pixclk_khz = t.pixclk_khz;
+	return m;
+}
+
+std::vector<hdr_mode> hdr_modes(const unsigned char *edid, unsigned num_blocks,
+				unsigned source_formats)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	hdr_caps caps = hdr_sink_caps(edid, num_blocks);
+	std::vector<hdr_mode> modes;
+	bool seen_vic[256] = {};
+	unsigned num_dtds = 0;
+
+	for (unsigned i = 0; i < 4; i++)
+		if (e.base().descriptor(i).is_dtd())
+			modes.push_back(make_mode("DTD " + std::to_string(++num_dtds), 0,
+						  e.base().descriptor(i).dtd_timings()));
+
+	for (auto blk : e.extensions()) {
+		cta_view cta(blk);
+
+		for (auto db : cta.data_blocks()) {
+			std::vector<unsigned char> vics;
+
+			for (unsigned i = 0; i < svd_view(db).count(); i++)
+				vics.push_back(svd_view(db).vic(i));
+			for (unsigned i = 0; i < y420vdb_view(db).count(); i++)
+				vics.push_back(y420vdb_view(db).vic(i));
+			for (auto vic : vics) {
+				const timings *t = find_vic_id(vic);
+
+				if (!t || seen_vic[vic])
+					continue;
+				seen_vic[vic] = true;
+				modes.push_back(make_mode("VIC " + std::to_string(vic), vic, *t));
+			}
+		}
+		if (cta.valid())
+			for (auto dtd : cta.dtds())
+				if (dtd.is_dtd())
+					modes.push_back(make_mode("DTD " + std::to_string(++num_dtds),
+								  0, dtd.dtd_timings()));
+	}
+	for (auto &m : modes)
+		hdr_negotiate(caps, source_formats, m);
+	return modes;
+}
+
+static std::string lum2s(double min_lum, double max_lum, double max_fall)
+{
+	char buf[96];
+
+	if (!max_lum)
+		return "";
+	if (max_fall)
+		snprintf(buf, sizeof(buf), ", %.4f-%.3f cd/m^2, max frame-average %.3f cd/m^2",
+			 min_lum, max_lum, max_fall);
+	else
+		snprintf(buf, sizeof(buf), ", %.4f-%.3f cd/m^2", min_lum, max_lum);
+	return buf;
+}
+
+int show_hdr_modes(const unsigned char *edid, unsigned num_blocks, unsigned source_formats)
+{
+	hdr_caps caps = hdr_sink_caps(edid, num_blocks);
+	std::vector<hdr_mode> modes = hdr_modes(edid, num_blocks, source_formats);
+
+	printf("Sink HDR formats: %s\n", hdr_formats2s(caps.formats).c_str());
+	printf("Source HDR formats: %s\n", hdr_formats2s(source_formats).c_str());
+	if ((caps.formats & (HDR_HDR10 | HDR_HLG)) && caps.max_lum)
+		printf("  HDR Static Metadata%s\n",
+		       lum2s(caps.min_lum, caps.max_lum, caps.max_fall).c_str());
+	if (caps.formats & (HDR_DOLBY_VISION | HDR_DOLBY_VISION_LL))
+		printf("  Dolby Vision version %u, %s%s\n", caps.dv_version, caps.dv_colorimetry,
+		       lum2s(caps.dv_min_lum, caps.dv_max_lum, 0).c_str());
+	if (caps.formats & HDR_FREESYNC)
+		printf("  FreeSync HDR%s\n", lum2s(caps.fs_min_lum, caps.fs_max_lum, 0).c_str());
+	printf("  Maximum bpc: RGB %u, YCbCr 4:4:4 %u, YCbCr 4:2:2 %u, YCbCr 4:2:0 %u\n",
+	       caps.max_bpc[HDR_RGB], caps.max_bpc[HDR_YCBCR444], caps.max_bpc[HDR_YCBCR422],
+	       caps.max_bpc[HDR_YCBCR420]);
+	if (caps.has_hdmi)
+		printf("  Maximum TMDS character rate: %u MHz, maximum FRL rate: %u Gbps\n",
+		       caps.max_tmds_mhz, caps.max_frl_gbps);
+
+	printf("HDR format per mode:\n");
+	for (const auto &m : modes) {
+		char buf[16];
+
+		sprintf(buf, "%u%s", m.vact, m.interlaced ? "i" : "");
+		printf("  %-8s %5ux%-5s %7.3f Hz: %s, %s %u bpc, EOTF %s, colorimetry %s%s\n",
+		       m.source.c_str(), m.hact, buf, m.refresh,
+		       m.format ? hdr_formats2s(m.format).c_str() : "SDR",
+		       encoding_names[m.encoding], m.bpc, m.eotf, m.colorimetry,
+		       lum2s(m.min_lum, m.max_lum, m.max_fall).c_str());
+	}
+	return 0;
+}
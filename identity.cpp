@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Physical device identity of an EDID.
+ *
+ * A display with several inputs, or connected through several docks,
+ * reports an EDID per input. The EDIDs of one physical device can be
+ * tied together through, in order of preference, the Container ID of the
+ * Microsoft VSDB or the DisplayID ContainerID Data Block, the Display
+ * Product Serial Number string, the Tiled Display Topology ID and the
+ * serial number of the base block. The strongest identity present is
+ * hashed into the device key. The serial string comes before the tile ID
+ * since all inputs report the serial string, but only the tiles of a
+ * tiled display report the tile ID. Different models can share a serial
+ * string, so it is combined with the serial number of the base block if
+ * there is one. The product code is not used there, since it can differ
+ * per input of the same device.
+ *
+ * The identity is written as a single tab separated line, followed by a
+ * summary of the capabilities of this input, so the EDIDs of a fleet can
+ * be grouped with sort(1) in bounded memory and the capabilities compared
+ * within each group, see misc/edid-group.sh.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "edid-view.h"
+
+struct identity {
+	std::string container_id;
+	std::string serial_string;
+	std::string tile_id;
+	std::string serial_number;
+};
+
+unsigned long long fnv1a_64(const std::string &s)
+{
+	unsigned long long h = 0xcbf29ce484222325ULL;
+
+	for (unsigned char c : s) {
+		h ^= c;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+// Serial numbers commonly used when there is no serial number
+static bool placeholder_serial(unsigned serial)
+{
+	return serial <= 1 || serial == 0x01010101;
+}
+
+// Serial number strings that are shared by many devices
+static bool placeholder_serial_string(const char *s)
+{
+	static const char *placeholders[] = {
+		"Serial", "SerialNumber", "Serial Number",
+		"0123456789", "123456789", "1234567890",
+		"H1AK500000",
+	};
+	unsigned i;
+
+	for (auto p : placeholders)
+		if (!strcmp(s, p))
+			return true;
+	// Repeats of a single character, e.g. '0000000000'
+	for (i = 1; s[i] && s[i] == s[0]; i++);
+	return !s[i];
+}
+
+static void parse_displayid(identity &id, displayid_view d)
+{
+	for (auto db : d.data_blocks()) {
+		byte_view p = db.payload();
+
+		// ContainerID Data Block
+		if (db.tag() == 0x29 && p.size() >= 16)
+			id.container_id = containerid2s(p.p);
+		// Tiled Display Topology Data Block, the ID is in the last 9 bytes
+		if ((db.tag() == 0x12 || db.tag() == 0x28) && p.size() >= 22 &&
+		    !placeholder_serial(p.le32(18))) {
+			char s[32];
+
+			snprintf(s, sizeof(s), "%c%c%c:%04x:%08x", p[13], p[14], p[15],
+				 p.le16(16), p.le32(18));
+			id.tile_id = s;
+		}
+	}
+}
+
+// The capabilities of this input that should be the same for all inputs
+static std::string capabilities(edid_view e)
+{
+	base_block_view base = e.base();
+	descriptor_view pref = base.descriptor(0);
+	unsigned char eotfs = 0;
+	bool audio = false;
+	unsigned max_tmds_mhz = 0, max_frl = 0;
+	std::string vrr = "-";
+	char s[128];
+	std::string caps;
+
+	if (pref.is_dtd()) {
+		unsigned htotal = pref.hact() + pref.hblank();
+		unsigned vtotal = pref.vact() + pref.vblank();
+
+		snprintf(s, sizeof(s), "%ux%u%s@%u", pref.hact(), pref.vact(),
+			 pref.interlaced() ? "i" : "",
+			 htotal && vtotal ? (pref.pixclk_khz() * 1000 + htotal * vtotal / 2) /
+			 (htotal * vtotal) : 0);
+	} else {
+		snprintf(s, sizeof(s), "-");
+	}
+	caps += std::string("preferred=") + s;
+
+	for (unsigned i = 0; i < 4; i++) {
+		descriptor_view d = base.descriptor(i);
+
+		if (d.tag() == 0xfd) {
+			snprintf(s, sizeof(s), "%u-%u", d.x[5], d.x[6]);
+			vrr = s;
+		}
+	}
+	caps += "\tvfreq=" + vrr;
+
+	for (auto blk : e.extensions()) {
+		cta_view cta(blk);
+
+		audio |= cta.basic_audio();
+		for (auto db : cta.data_blocks()) {
+			audio |= db.tag() == 0x01;
+			if (hdr_static_view(db).valid())
+				eotfs |= hdr_static_view(db).eotfs();
+			max_tmds_mhz = max(max_tmds_mhz, hdmi_vsdb_view(db).max_tmds_mhz());
+			if (hf_scdb_view(db).valid()) {
+				max_tmds_mhz = max(max_tmds_mhz, hf_scdb_view(db).max_tmds_mhz());
+				max_frl = max(max_frl, hf_scdb_view(db).max_frl());
+			}
+		}
+	}
+	snprintf(s, sizeof(s), "\teotfs=0x%02x\taudio=%s\tmax-tmds=%u\tmax-frl=%u\tmade=%u-w%u",
+		 eotfs, audio ? "yes" : "no", max_tmds_mhz, max_frl,
+		 base.year(), base.week());
+	return caps + s;
+}
+
+int identity_key(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	base_block_view base = e.base();
+	identity id;
+	char pnp[4];
+	char s[64];
+
+	base.manufacturer(pnp);
+	for (unsigned i = 0; i < 4; i++) {
+		descriptor_view d = base.descriptor(i);
+		char str[14];
+
+		if (d.tag() == 0xff && *d.string(str) && !placeholder_serial_string(str))
+			id.serial_string = std::string(pnp) + ":" + str;
+	}
+	if (!placeholder_serial(base.serial())) {
+		snprintf(s, sizeof(s), "%s:%04x:%08x", pnp, base.product(), base.serial());
+		id.serial_number = s;
+	}
+	for (auto blk : e.extensions()) {
+		for (auto db : cta_view(blk).data_blocks())
+			if (db.oui() == 0xca125c && db.payload().size() >= 21)
+				id.container_id = containerid2s(db.payload().p + 5);
+		parse_displayid(id, displayid_view(blk));
+	}
+
+	std::string key;
+
+	if (!id.container_id.empty()) {
+		key = "container-id:" + id.container_id;
+	} else if (!id.serial_string.empty()) {
+		key = "serial-string:" + id.serial_string;
+		if (!placeholder_serial(base.serial())) {
+			snprintf(s, sizeof(s), ":%08x", base.serial());
+			key += s;
+		}
+	} else if (!id.tile_id.empty()) {
+		key = "tile-id:" + id.tile_id;
+	} else if (!id.serial_number.empty()) {
+		key = "serial-number:" + id.serial_number;
+	}
+
+	if (key.empty())
+		printf("-");
+	else
+		printf("%016llx", fnv1a_64(key));
+	printf("\t%s\t%s\t%s\t%s\t%s\t%s\n", key.empty() ? "-" : key.c_str(),
+	       id.container_id.empty() ? "-" : id.container_id.c_str(),
+	       id.serial_string.empty() ? "-" : id.serial_string.c_str(),
+	       id.tile_id.empty() ? "-" : id.tile_id.c_str(),
+	       id.serial_number.empty() ? "-" : id.serial_number.c_str(),
+	       capabilities(e).c_str());
+	return 0;
+}
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Infer the GTF or CVT formula variant used to generate the DTDs of an EDID.
+ *
+ * DTDs that are identical to a VIC or DMT are reported as such, all other
+ * DTDs are compared against the CVT variants (including the RBv3
+ * blanking options) and the default GTF curve. In addition a single
+ * secondary GTF curve is fitted against all DTDs together by a grid
+ * search over C' and M', which are the only secondary curve parameters
+ * that affect the calculated timings.
+ *
+ * The search is a plain loop: every grid point goes through
+ * calc_gtf_mode(), which rounds the intermediate results in several
+ * steps like the VESA spreadsheet does, so it cannot be turned into
+ * straight-line vector code without reimplementing GTF. The grid is
+ * small enough (about 20000 points) that this does not matter.
+ */
+
+#include <math.h>
+
+#include "edid-decode.h"
+
+struct formula_fit {
+	std::string formula;
+	unsigned hdiff;	// sum of the horizontal porch and sync differences
+	unsigned vdiff;	// sum of the vertical porch and sync differences
+	int clk_diff_khz;
+
+	formula_fit() : hdiff(~0U), vdiff(~0U), clk_diff_khz(0) {}
+	bool exact() const { return !hdiff && !vdiff && abs(clk_diff_khz) <= 10; }
+	double cost(const timings &t) const
+	{
+		if (hdiff == ~0U)
+			return HUGE_VAL;
+		return hdiff + vdiff + 100.0 * abs(clk_diff_khz) / t.pixclk_khz;
+	}
+};
+
+static formula_fit compare(const timings &t, const timings &calc, const std::string &formula)
+{
+	formula_fit fit;
+
+	if (calc.hact != t.hact || calc.vact != t.vact || calc.hborder != t.hborder ||
+	    calc.vborder != t.vborder)
+		return fit;
+	fit.formula = formula;
+	fit.hdiff = abs((int)calc.hfp - t.hfp) + abs((int)calc.hsync - (int)t.hsync) +
+		abs((int)calc.hbp - t.hbp);
+	fit.vdiff = abs((int)calc.vfp - (int)t.vfp) + abs((int)calc.vsync - (int)t.vsync) +
+		abs((int)calc.vbp - t.vbp);
+	fit.clk_diff_khz = (int)calc.pixclk_khz - (int)t.pixclk_khz;
+	return fit;
+}
+
+static void keep_best(formula_fit &best, const formula_fit &fit, const timings &t)
+{
+	if (fit.cost(t) < best.cost(t))
+		best = fit;
+}
+
+// The frame rate of the timings, which is what the formulas expect
+static double frame_rate(const timings &t)
+{
+	unsigned htotal = t.hact + t.hfp + t.hsync + t.hbp + 2 * t.hborder;
+	double vtotal = t.vact + t.vfp + t.vsync + t.vbp + 2 * t.vborder;
+
+	if (t.interlaced)
+		vtotal = t.vact + 2 * (t.vfp + t.vsync + t.vbp + 2 * t.vborder) + 1;
+	return htotal && vtotal ? t.pixclk_khz * 1000.0 / (htotal * vtotal) : 0;
+}
+
+/*
+ * The requested refresh rate is not stored in a DTD: try the nearest
+ * integer rate, the rate that becomes the measured rate after a 1000/1001
+ * reduction and the measured rate itself.
+ */
+static std::vector<double> refresh_candidates(const timings &t)
+{
+	double fps = frame_rate(t);
+	std::vector<double> v;
+
+	if (fps <= 0)
+		return v;
+	v.push_back(round(fps));
+	if (round(fps * 1.001) != round(fps))
+		v.push_back(round(fps * 1.001));
+	v.push_back(fps);
+	return v;
+}
+
+static bool same_timings(const timings &t1, const timings &t2)
+{
+	return t1.hact == t2.hact && t1.vact == t2.vact &&
+		t1.interlaced == t2.interlaced && t1.pixclk_khz == t2.pixclk_khz &&
+		t1.hfp == t2.hfp && t1.hsync == t2.hsync && t1.hbp == t2.hbp &&
+		t1.vfp == t2.vfp && t1.vsync == t2.vsync && t1.vbp == t2.vbp &&
+		!t1.hborder && !t1.vborder && !t2.hborder && !t2.vborder;
+}
+
+// Returns the VIC or DMT that is identical to the timings, if any
+static std::string table_timings(const timings &t)
+{
+	char buf[16];
+
+	for (unsigned vic = 1; vic < 256; vic++) {
+		const timings *v = find_vic_id(vic);
+
+		if (v && same_timings(t, *v)) {
+			sprintf(buf, "VIC %u", vic);
+			return buf;
+		}
+	}
+	for (unsigned dmt = 1; dmt < 256; dmt++) {
+		const timings *d = find_dmt_id(dmt);
+
+		if (d && same_timings(t, *d)) {
+			sprintf(buf, "DMT 0x%02x", dmt);
+			return buf;
+		}
+	}
+	return "";
+}
+
+static formula_fit best_standard_fit(edid_state &state, const timings &t)
+{
+	formula_fit best;
+	char buf[64];
+
+	for (auto fps : refresh_candidates(t)) {
+		// Report the refresh rate the way --cvt and --gtf expect it
+		double rate = t.interlaced ? 2 * fps : fps;
+
+		for (unsigned margins = 0; margins <= 1; margins++) {
+			const char *m = margins ? ", margins" : "";
+
+			snprintf(buf, sizeof(buf), "CVT %.3f Hz%s", rate, m);
+			keep_best(best, compare(t, state.calc_cvt_mode(t.hact, t.vact, fps, RB_NONE,
+								       t.interlaced, margins), buf), t);
+			snprintf(buf, sizeof(buf), "CVT RBv1 %.3f Hz%s", rate, m);
+			keep_best(best, compare(t, state.calc_cvt_mode(t.hact, t.vact, fps, RB_CVT_V1,
+								       t.interlaced, margins), buf), t);
+			snprintf(buf, sizeof(buf), "GTF %.3f Hz%s", rate, m);
+			keep_best(best, compare(t, state.calc_gtf_mode(t.hact, t.vact, fps,
+								       t.interlaced, gtf_ip_vert_freq,
+								       margins), buf), t);
+		}
+		if (t.interlaced)
+			continue;
+		for (unsigned alt = 0; alt <= 1; alt++) {
+			snprintf(buf, sizeof(buf), "CVT RBv2 %.3f Hz%s", fps, alt ? ", video-optimized" : "");
+			keep_best(best, compare(t, state.calc_cvt_mode(t.hact, t.vact, fps, RB_CVT_V2,
+								       false, false, alt), buf), t);
+		}
+		for (unsigned hblank = 80; hblank <= 200; hblank += 8) {
+			for (unsigned opts = 0; opts < 4; opts++) {
+				bool early_vsync = opts & 1;
+				bool video_opt = opts & 2;
+
+				snprintf(buf, sizeof(buf), "CVT RBv3 %.3f Hz, h-blank %u%s%s", fps, hblank,
+					 early_vsync ? ", early-vsync" : "",
+					 video_opt ? ", video-optimized" : "");
+				keep_best(best, compare(t, state.calc_cvt_mode(t.hact, t.vact, fps, RB_CVT_V3,
+									       false, false, false, hblank, 0,
+									       early_vsync, video_opt), buf), t);
+			}
+		}
+	}
+	snprintf(buf, sizeof(buf), "GTF %.3f MHz", t.pixclk_khz / 1000.0);
+	keep_best(best, compare(t, state.calc_gtf_mode(t.hact, t.vact, t.pixclk_khz / 1000.0,
+						       t.interlaced, gtf_ip_clk_freq), buf), t);
+	return best;
+}
+
+/*
+ * Secondary GTF curve fitted against all timings: passing K = 256 and
+ * J = 0 to calc_gtf_mode() makes C and M equal to C' and M'.
+ */
+struct gtf_curve {
+	double c_prime, m_prime;
+	double cost;
+	unsigned exact;
+	std::vector<formula_fit> fits;
+};
+
+static gtf_curve eval_gtf_curve(edid_state &state, const vec_timings_ext &dtds,
+				double c_prime, double m_prime)
+{
+	gtf_curve curve = { c_prime, m_prime, 0, 0, {} };
+
+	for (const auto &te : dtds) {
+		const timings &t = te.t;
+		formula_fit best;
+
+		for (auto fps : refresh_candidates(t))
+			keep_best(best, compare(t, state.calc_gtf_mode(t.hact, t.vact, fps, t.interlaced,
+								       gtf_ip_vert_freq, false, true,
+								       c_prime, m_prime, 256, 0), ""), t);
+		keep_best(best, compare(t, state.calc_gtf_mode(t.hact, t.vact, t.pixclk_khz / 1000.0,
+							       t.interlaced, gtf_ip_clk_freq, false, true,
+							       c_prime, m_prime, 256, 0), ""), t);
+		curve.cost += best.cost(t) == HUGE_VAL ? 1000 : best.cost(t);
+		curve.exact += best.exact();
+		curve.fits.push_back(best);
+	}
+	return curve;
+}
+
+static gtf_curve fit_gtf_curve(edid_state &state, const vec_timings_ext &dtds)
+{
+	gtf_curve best = eval_gtf_curve(state, dtds, 40, 300);
+
+	// Coarse grid over the full C' range and the plausible M' range
+	for (double c = 0; c <= 100; c += 1)
+		for (double m = 0; m <= 2000; m += 10) {
+			gtf_curve curve = eval_gtf_curve(state, dtds, c, m);
+
+			if (curve.cost < best.cost)
+				best = curve;
+		}
+	// Refine around the best coarse grid point
+	double c0 = best.c_prime, m0 = best.m_prime;
+
+	for (double c = max(0.0, c0 - 1); c <= c0 + 1; c += 0.25)
+		for (double m = max(0.0, m0 - 10); m <= m0 + 10; m += 0.5) {
+			gtf_curve curve = eval_gtf_curve(state, dtds, c, m);
+
+			if (curve.cost < best.cost)
+				best = curve;
+		}
+	return best;
+}
+
+static std::string fit2s(const formula_fit &fit, const timings &t)
+{
+	char buf[128];
+
+	if (fit.hdiff == ~0U)
+		return "no matching formula";
+	if (fit.exact())
+		return fit.formula + ", exact";
+	snprintf(buf, sizeof(buf), ", off by %u pixels, %u lines, %.2f%% pixel clock",
+		 fit.hdiff, fit.vdiff, 100.0 * fit.clk_diff_khz / t.pixclk_khz);
+	return fit.formula + buf;
+}
+
+int edid_state::infer_formulas()
+{
+	vec_timings_ext dtds;
+
+	for (const auto &te : cta.vec_dtds)
+		if (table_timings(te.t).empty())
+			dtds.push_back(te);
+
+	gtf_curve curve = fit_gtf_curve(*this, dtds);
+	unsigned exact = 0;
+	char buf[128];
+
+	snprintf(buf, sizeof(buf), "GTF secondary curve C'=%.2f M'=%.1f", curve.c_prime, curve.m_prime);
+	printf("Formula inference:\n");
+	for (unsigned i = 0, j = 0; i < cta.vec_dtds.size(); i++) {
+		timings t = cta.vec_dtds[i].t;
+		std::string table = table_timings(t);
+		std::string s;
+
+		if (table.empty()) {
+			formula_fit best = best_standard_fit(*this, t);
+			formula_fit sec = curve.fits[j++];
+
+			sec.formula = buf;
+			// Prefer the standard formulas if the secondary curve is no better
+			if (sec.cost(t) < best.cost(t))
+				best = sec;
+			exact += best.exact();
+			s = fit2s(best, t);
+		} else {
+			s = table + ", not formula based";
+		}
+		t.hsize_mm = t.vsize_mm = 0;
+		print_timings("  ", &t, cta.vec_dtds[i].type.c_str(), s.c_str(), false, false);
+	}
+	if (dtds.empty()) {
+		printf("No formula based Detailed Timing Descriptors found.\n");
+		return 0;
+	}
+	if (!curve.exact) {
+		printf("Best secondary GTF curve: no formula fits\n");
+	} else {
+		printf("Best secondary GTF curve: C'=%.2f M'=%.1f", curve.c_prime, curve.m_prime);
+		// One of the possible encodings: K = 128, J = 20
+		double c = 2 * curve.c_prime - 20, m = 2 * curve.m_prime;
+		if (c >= 0 && c <= 127.5 && m <= 65535)
+			printf(" (C=%.1f M=%.0f K=128 J=20)", c, m);
+		printf(", %u of %zu timings exact\n", curve.exact, dtds.size());
+	}
+	printf("Fit: %u of %zu formula based timings reproduced exactly\n", exact, dtds.size());
+	return 0;
+}
@@ -0,0 +1,430 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Precompute the InfoFrames a source sends to the sink for each mode.
+ *
+ * For every mode the sink advertises (SVDs, HDMI VICs and DTDs) and every
+ * pixel format it supports for that mode, the AVI InfoFrame is built from
+ * the VIC, the VCDB quantization bits and the Colorimetry Data Block, plus
+ * the HDMI Vendor-Specific InfoFrame for HDMI VICs. For the EDID as a whole
+ * the Audio InfoFrame is built from the Speaker Allocation Data Block, a
+ * Dynamic Range and Mastering InfoFrame for each supported EOTF and a
+ * Vendor-Specific InfoFrame for each VSIF listed in the InfoFrame Data
+ * Block.
+ *
+ * The templates are complete InfoFrames including the checksum, so a mode
+ * set only has to copy bytes. Fields that depend on the content rather
+ * than on the sink (bar info, content type, mastering metadata) are 0.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "edid-view.h"
+
+typedef std::vector<unsigned char> infoframe;
+
+// The AVI InfoFrame Y values
+enum pixel_format {
+	PIX_RGB,
+	PIX_YCBCR422,
+	PIX_YCBCR444,
+	PIX_YCBCR420,
+};
+
+static const char *pixel_format_names[] = {
+	"RGB", "YCbCr 4:2:2", "YCbCr 4:4:4", "YCbCr 4:2:0",
+};
+
+static const char *eotf_names[] = {
+	"SDR", "HDR", "SMPTE ST2084", "HLG",
+};
+
+struct infoframe_caps {
+	bool ycbcr444, ycbcr422;
+	bool rgb_quant_selectable;
+	bool bt2020_rgb, bt2020_ycc;
+	bool has_audio;
+	unsigned speakers;
+	unsigned char eotfs;
+	std::vector<unsigned char> vics;	// in SVD order
+	bool has_vic[256];
+	bool ycbcr420[256];
+	bool ycbcr420_only[256];
+	std::vector<unsigned char> hdmi_vics;
+	std::vector<unsigned> vsif_ouis;
+	std::vector<descriptor_view> dtds;
+
+	infoframe_caps() :
+		ycbcr444(false), ycbcr422(false), rgb_quant_selectable(false),
+		bt2020_rgb(false), bt2020_ycc(false), has_audio(false),
+		speakers(0), eotfs(0), has_vic(), ycbcr420(), ycbcr420_only() {}
+};
+
+static infoframe make_infoframe(unsigned char type, unsigned char version,
+				const infoframe &payload)
+{
+	infoframe f = { type, version, (unsigned char)payload.size(), 0 };
+	unsigned char sum = 0;
+
+	f.insert(f.end(), payload.begin(), payload.end());
+	for (auto b : f)
+		sum += b;
+	f[3] = -sum;
+	return f;
+}
+
+static void add_vic(infoframe_caps &caps, unsigned char vic)
+{
+	if (!vic || caps.has_vic[vic])
+		return;
+	caps.has_vic[vic] = true;
+	caps.vics.push_back(vic);
+}
+
+static void parse_hdmi_vsdb(infoframe_caps &caps, byte_view x)
+{
+	// The payload includes the OUI, the latency fields are optional
+	if (x.size() < 8 || !(x[7] & 0x20))
+		return;
+
+	unsigned i = 8 + ((x[7] & 0x80) ? 2 : 0) + ((x[7] & 0x40) ? 2 : 0);
+	unsigned hdmi_vic_len = x[i + 1] >> 5;
+
+	for (unsigned j = 0; j < hdmi_vic_len; j++)
+		if (x[i + 2 + j])
+			caps.hdmi_vics.push_back(x[i + 2 + j]);
+}
+
+static void parse_ifdb(infoframe_caps &caps, byte_view x)
+{
+	unsigned i = (x[0] >> 5) + 2;
+
+	while (i < x.size()) {
+		unsigned type = x[i] & 0x1f;
+		unsigned payload_len = x[i] >> 5;
+
+		if (type == 1 && i + 4 <= x.size()) {
+			caps.vsif_ouis.push_back(x.le24(i + 1));
+			i += 3;
+		}
+		i += 1 + payload_len;
+	}
+}
+
+static void parse_cta(infoframe_caps &caps, cta_view cta, std::vector<unsigned char> &svds,
+		      std::vector<cmdb_view> &cmdbs)
+{
+	caps.ycbcr444 |= cta.ycbcr444();
+	caps.ycbcr422 |= cta.ycbcr422();
+	caps.has_audio |= cta.basic_audio();
+
+	for (auto db : cta.data_blocks()) {
+		byte_view p = db.payload();
+
+		switch (db.tag()) {
+		case 0x01:
+			caps.has_audio = true;
+			break;
+		case 0x02:
+			for (unsigned i = 0; i < p.size(); i++) {
+				unsigned char vic = svd_view(db).vic(i);
+
+				svds.push_back(vic);
+				add_vic(caps, vic);
+			}
+			break;
+		case 0x03:
+			if (db.oui() == 0x000c03)
+				parse_hdmi_vsdb(caps, p);
+			break;
+		case 0x04:
+			caps.speakers = p[0] | (p[1] << 8);
+			break;
+		}
+
+		switch (db.ext_tag()) {
+		case 0x00:
+			caps.rgb_quant_selectable = p[0] & 0x40;
+			break;
+		case 0x05:
+			caps.bt2020_ycc = p[0] & 0x40;
+			caps.bt2020_rgb = p[0] & 0x80;
+			break;
+		case 0x06:
+			caps.eotfs = hdr_static_view(db).eotfs();
+			break;
+		case 0x0e:
+			for (unsigned i = 0; i < y420vdb_view(db).count(); i++) {
+				unsigned char vic = y420vdb_view(db).vic(i);
+
+				caps.ycbcr420_only[vic] = caps.ycbcr420[vic] = true;
+				add_vic(caps, vic);
+			}
+			break;
+		case 0x0f:
+			cmdbs.push_back(cmdb_view(db));
+			break;
+		case 0x20:
+			parse_ifdb(caps, p);
+			break;
+		}
+	}
+	for (auto dtd : cta.dtds())
+		caps.dtds.push_back(dtd);
+}
+
+static infoframe_caps parse_caps(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	infoframe_caps caps;
+	std::vector<unsigned char> svds;
+	std::vector<cmdb_view> cmdbs;
+
+	for (unsigned i = 0; i < 4; i++)
+		if (e.base().descriptor(i).is_dtd())
+			caps.dtds.push_back(e.base().descriptor(i));
+	for (auto blk : e.extensions())
+		parse_cta(caps, cta_view(blk), svds, cmdbs);
+
+	// The YCbCr 4:2:0 Capability Map refers to the SVDs of all Video Data Blocks
+	for (auto cmdb : cmdbs)
+		for (unsigned i = 0; i < svds.size(); i++)
+			if (cmdb.ycbcr420(i))
+				caps.ycbcr420[svds[i]] = true;
+	return caps;
+}
+
+/*
+ * The Video Format Identification Code of the VIC that is identical to the
+ * DTD. Most formats have a 4:3 and a 16:9 VIC with the same timings, the
+ * image size of the DTD picks the one with the closest aspect ratio.
+ */
+static unsigned char dtd_vic(const descriptor_view &dtd)
+{
+	double aspect = dtd.vsize_mm() ? (double)dtd.hsize_mm() / dtd.vsize_mm() : 0;
+	unsigned char best = 0;
+	double best_diff = 0;
+
+	for (unsigned vic = 1; vic < 256; vic++) {
+		const timings *t = find_vic_id(vic);
+
+		if (!t || t->hact != dtd.hact() ||
+		    t->vact != dtd.vact() + (dtd.interlaced() ? dtd.vact() : 0) ||
+		    t->pixclk_khz != dtd.pixclk_khz() || t->interlaced != dtd.interlaced() ||
+		    (unsigned)(t->hfp + t->hsync + t->hbp) != dtd.hblank())
+			continue;
+
+		double diff = fabs((double)t->hratio / t->vratio - aspect);
+
+		if (!best || (aspect && diff < best_diff)) {
+			best = vic;
+			best_diff = diff;
+		}
+	}
+	return best;
+}
+
+/*
+ * Build the AVI InfoFrame. A VIC of 0 is an IT format, otherwise the VIC
+ * is a CE format with a limited default RGB quantization range (except
+ * for VIC 1).
+ */
+static infoframe avi_infoframe(const infoframe_caps &caps, unsigned char vic,
+			       const timings *t, pixel_format fmt, bool bt2020)
+{
+	infoframe p(13);
+	bool sd = t && t->vact <= 576;
+
+	p[0] = fmt << 5;
+	if (bt2020) {
+		// Extended colorimetry: BT.2020 RGB or YCbCr
+		p[1] = 3 << 6;
+		p[2] = 6 << 4;
+	} else if (fmt != PIX_RGB) {
+		p[1] = (sd ? 1 : 2) << 6;
+	}
+	if (vic && t) {
+		if (t->hratio == 4 && t->vratio == 3)
+			p[1] |= 1 << 4;
+		else if (t->hratio == 16 && t->vratio == 9)
+			p[1] |= 2 << 4;
+	}
+	// Active format present (A0): same as the picture aspect ratio
+	p[0] |= 0x10;
+	p[1] |= 8;
+	if (fmt == PIX_RGB && caps.rgb_quant_selectable)
+		p[2] |= (vic > 1 ? 1 : 2) << 2;
+	p[3] = vic;
+	// 1440 pixel wide 480i/240p/576i/288p formats repeat each pixel once
+	if (t && vic && t->hact == 1440 && t->vact <= 576 &&
+	    (t->interlaced || t->vact <= 288))
+		p[4] = 1;
+	// 8 bit VICs need version 3
+	return make_infoframe(0x82, vic > 127 ? 3 : 2, p);
+}
+
+static infoframe hdmi_vsif(unsigned char hdmi_vic)
+{
+	infoframe p = { 0x03, 0x0c, 0x00, 1 << 5, hdmi_vic };
+
+	return make_infoframe(0x81, 1, p);
+}
+
+static infoframe vsif(unsigned oui)
+{
+	infoframe p = { (unsigned char)oui, (unsigned char)(oui >> 8), (unsigned char)(oui >> 16), 0 };
+
+	// The HDMI Forum VSIF has a version and a flags byte
+	if (oui == 0xc45dd8) {
+		p[3] = 1;
+		p.push_back(0);
+	}
+	return make_infoframe(0x81, 1, p);
+}
+
+// The speakers of the Audio InfoFrame channel allocations 0x00-0x1f
+static unsigned ca_speakers(unsigned ca)
+{
+	// FL/FR, LFE1 and FC, then the rear/center speakers
+	static const unsigned char rear[] = {
+		0x00, 0x10, 0x08, 0x18, 0x48, 0x20, 0x30, 0x28,
+	};
+
+	return 0x01 | ((ca & 1) ? 0x02 : 0) | ((ca & 2) ? 0x04 : 0) | rear[ca >> 2];
+}
+
+static unsigned ca_channels(unsigned speakers)
+{
+	unsigned channels = 0;
+
+	// FL/FR, BL/BR, FLc/FRc and RLC/RRC are pairs
+	for (unsigned i = 0; i < 8; i++)
+		if (speakers & (1 << i))
+			channels += (0x69 & (1 << i)) ? 2 : 1;
+	return channels;
+}
+
+// The channel allocation with the most channels that the sink has speakers for
+static infoframe audio_infoframe(const infoframe_caps &caps)
+{
+	unsigned speakers = caps.speakers ? caps.speakers : 0x01;
+	unsigned best = 0;
+	infoframe p(10);
+
+	for (unsigned ca = 1; ca < 0x20; ca++)
+		if ((ca_speakers(ca) & ~speakers) == 0 &&
+		    ca_channels(ca_speakers(ca)) > ca_channels(ca_speakers(best)))
+			best = ca;
+	p[0] = ca_channels(ca_speakers(best)) - 1;
+	p[3] = best;
+	return make_infoframe(0x84, 1, p);
+}
+
+static infoframe drm_infoframe(unsigned eotf)
+{
+	infoframe p(26);
+
+	p[0] = eotf;
+	return make_infoframe(0x87, 1, p);
+}
+
+static std::string mode_name(const timings *t)
+{
+	char buf[64];
+
+	if (!t)
+		return "";
+
+	unsigned htotal = t->hact + t->hfp + t->hsync + t->hbp;
+	double vtotal = t->vact + t->vfp + t->vsync + t->vbp;
+
+	if (t->interlaced)
+		vtotal = t->vact + 2 * (t->vfp + t->vsync + t->vbp) + 1;
+	snprintf(buf, sizeof(buf), "%ux%u%c%.2f", t->hact, t->vact, t->interlaced ? 'i' : 'p',
+		 htotal && vtotal ? t->pixclk_khz * 1000.0 * (t->interlaced ? 2 : 1) / (htotal * vtotal) : 0);
+	return buf;
+}
+
+static void show_infoframe(const char *mode, const std::string &name, const char *format,
+			   const char *type, const infoframe &f)
+{
+	printf("  %-13s %-18s %-19s %-5s", mode, name.c_str(), format, type);
+	for (auto b : f)
+		printf(" %02x", b);
+	printf("\n");
+}
+
+static void show_avi(const infoframe_caps &caps, const char *mode, unsigned char vic,
+		     const timings *t, bool ycbcr420, bool ycbcr420_only)
+{
+	std::string name = mode_name(t);
+
+	for (unsigned fmt = PIX_RGB; fmt <= PIX_YCBCR420; fmt++) {
+		if (ycbcr420_only && fmt != PIX_YCBCR420)
+			continue;
+		if ((fmt == PIX_YCBCR422 && !caps.ycbcr422) ||
+		    (fmt == PIX_YCBCR444 && !caps.ycbcr444) ||
+		    (fmt == PIX_YCBCR420 && !ycbcr420))
+			continue;
+
+		bool bt2020 = fmt == PIX_RGB ? caps.bt2020_rgb : caps.bt2020_ycc;
+		std::string format = pixel_format_names[fmt];
+
+		show_infoframe(mode, name, format.c_str(), "AVI",
+			       avi_infoframe(caps, vic, t, (pixel_format)fmt, false));
+		if (bt2020)
+			show_infoframe(mode, name, (format + " BT.2020").c_str(), "AVI",
+				       avi_infoframe(caps, vic, t, (pixel_format)fmt, true));
+	}
+}
+
+int infoframe_templates(const unsigned char *edid, unsigned num_blocks)
+{
+	infoframe_caps caps = parse_caps(edid, num_blocks);
+	char mode[32];
+
+	printf("InfoFrame templates:\n");
+	printf("  %-13s %-18s %-19s %-5s %s\n", "Mode", "Timings", "Format", "Type",
+	       "Header, checksum and payload");
+
+	for (auto vic : caps.vics) {
+		snprintf(mode, sizeof(mode), "VIC %u", vic);
+		show_avi(caps, mode, vic, find_vic_id(vic), caps.ycbcr420[vic],
+			 caps.ycbcr420_only[vic]);
+	}
+
+	for (auto hdmi_vic : caps.hdmi_vics) {
+		// The sink also lists the VIC, which is preferred over the HDMI VIC
+		if (caps.has_vic[hdmi_vic_to_vic(hdmi_vic)])
+			continue;
+
+		const timings *t = find_hdmi_vic_id(hdmi_vic);
+
+		snprintf(mode, sizeof(mode), "HDMI VIC %u", hdmi_vic);
+		show_avi(caps, mode, 0, t, false, false);
+		show_infoframe(mode, mode_name(t), "", "VSIF", hdmi_vsif(hdmi_vic));
+	}
+
+	for (unsigned i = 0; i < caps.dtds.size(); i++) {
+		const descriptor_view &dtd = caps.dtds[i];
+		unsigned char vic = dtd_vic(dtd);
+
+		// Identical to an SVD, so already listed
+		if (caps.has_vic[vic])
+			continue;
+
+		timings t = dtd.dtd_timings();
+
+		snprintf(mode, sizeof(mode), "DTD %u", i + 1);
+		show_avi(caps, mode, vic, vic ? find_vic_id(vic) : &t, false, false);
+	}
+
+	if (caps.has_audio)
+		show_infoframe("EDID", "", "", "Audio", audio_infoframe(caps));
+	for (unsigned eotf = 0; eotf < ARRAY_SIZE(eotf_names); eotf++)
+		if (caps.eotfs & (1 << eotf))
+			show_infoframe("EDID", "", eotf_names[eotf], "DRM", drm_infoframe(eotf));
+	for (auto oui : caps.vsif_ouis)
+		show_infoframe("EDID", "", ouitohex(oui).c_str(), "VSIF", vsif(oui));
+	return 0;
+}
@@ -0,0 +1,74 @@
+#!/bin/bash -e
+
+# Deduplicate a corpus of EDIDs on their contents rather than their bytes.
+#
+# Usage: edid-dedup.sh <outdir> <edid>...
+#        find /path/to/corpus -type f | edid-dedup.sh <outdir>
+#
+# Runs 'edid-decode --semantic-hash hash' over every EDID in parallel ($JOBS
+# jobs, default: number of CPUs). EDIDs with the same semantic hash describe
+# the same display, even if the data blocks are in a different order, the
+# DTDs are placed in another block or only the serial numbers and checksums
+# differ. The first EDID (in sorted path order) of each hash is copied to
+# <outdir>, and <outdir>/dedup.tsv lists the hash, the copied name and the
+# original path of every EDID.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <outdir> [<edid>...]" >&2
+    exit 1
+fi
+OUT="$1"
+shift
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+export EDID_DECODE TMP
+
+# One line per EDID: hash <tab> edid
+hash_one() {
+    local h
+
+    h="$("$EDID_DECODE" --semantic-hash hash "$1" 2>/dev/null)" && printf '%s\t%s\n' "$h" "$1"
+}
+export -f hash_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 64 bash -c 'for f; do hash_one "$f"; done > "$TMP/$$.$RANDOM.hash"' _
+
+mkdir -p "$OUT"
+find "$TMP" -name '*.hash' -exec cat {} + |
+    LC_ALL=C sort -t "$(printf '\t')" -k1,1 -k2 |
+    while IFS="$(printf '\t')" read -r hash edid; do
+        if [ "$hash" != "$last" ]; then
+            last="$hash"
+            name="$(basename "$edid")"
+            i=1
+            while [ -e "$OUT/$name" ]; do
+                name="$(basename "$edid").$i"
+                i=$((i + 1))
+            done
+            cp "$edid" "$OUT/$name"
+        fi
+        printf '%s\t%s\t%s\n' "$hash" "$name" "$edid"
+    done > "$TMP/dedup.tsv"
+mv "$TMP/dedup.tsv" "$OUT/dedup.tsv"
+
+printf '%u of %u EDIDs kept\n' \
+    "$(cut -f 1 "$OUT/dedup.tsv" | uniq | wc -l)" "$(wc -l < "$OUT/dedup.tsv")" >&2
@@ -0,0 +1,139 @@
+#!/bin/bash -e
+
+# Compare the output of two edid-decode builds over a corpus of EDIDs.
+#
+# Usage: edid-diff.sh <old edid-decode> <new edid-decode> <edid>...
+#        find /path/to/corpus -type f | edid-diff.sh <old> <new>
+#
+# Both builds decode every EDID with --check, in parallel ($JOBS jobs,
+# default: number of CPUs). Volatile lines (the 'edid-decode SHA:' line)
+# and empty lines are dropped before comparing. The differences are then grouped:
+#
+# - conformity verdict changes (PASS -> FAIL and FAIL -> PASS),
+# - warnings and failures that appeared or disappeared, by message ID
+#   (the message text with all numbers replaced by '#'),
+# - changed decode output lines, by block type and data block.
+#
+# Each group is reported with the number of EDIDs it affects and one
+# representative EDID. Set EDID_DECODE_OPTS to pass extra options to both
+# builds, and KEEP=<dir> to keep the per-EDID difference records.
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <old edid-decode> <new edid-decode> [<edid>...]" >&2
+    exit 1
+fi
+
+OLD="$(command -v "$1")"
+NEW="$(command -v "$2")"
+shift 2
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+WORKDIR="${KEEP:-$(mktemp -d)}"
+mkdir -p "$WORKDIR"
+[ -n "$KEEP" ] || trap 'rm -rf "$WORKDIR"' EXIT
+
+export OLD NEW WORKDIR EDID_DECODE_OPTS
+
+# Prefix every line of the edid-decode output with its context:
+# kind <tab> block type/data block <tab> normalized line
+annotate() {
+    awk '
+    function id(s) {
+        gsub(/0x[0-9a-fA-F]+/, "#", s)
+        gsub(/[0-9]+(\.[0-9]+)?/, "#", s)
+        return s
+    }
+    /^edid-decode SHA:/ || /^$/ { next }
+    /^Warnings:$/ { sect = "warn"; next }
+    /^Failures:$/ { sect = "fail"; next }
+    /^EDID conformity:/ { print "verdict\t-\t" $3; next }
+    sect == "" && /^Block [0-9]+, / {
+        blk = $0; sub(/^Block [0-9]+, /, "", blk); sub(/:$/, "", blk); db = ""
+        next
+    }
+    sect == "" && /^  [^ ].*:$/ { db = substr($0, 3); sub(/:$/, "", db) }
+    sect == "" { print "decode\t" blk (db == "" ? "" : " / " db) "\t" $0; next }
+    /^Block [0-9]+, / { blk = $0; sub(/^Block [0-9]+, /, "", blk); sub(/:$/, "", blk); next }
+    /^EDID:$/ { blk = "EDID"; next }
+    /^  / {
+        m = substr($0, 3); d = "-"
+        if ((i = index(m, ": ")) > 0) { d = substr(m, 1, i - 1); m = substr(m, i + 2) }
+        print sect "\t" blk " / " d "\t" id(m)
+    }'
+}
+export -f annotate
+
+# Emit the difference records of one EDID:
+# edid <tab> +/- <tab> kind <tab> group <tab> line
+diff_one() {
+    local edid="$1"
+    local old new
+    old="$("$OLD" --check $EDID_DECODE_OPTS "$edid" 2>&1 | annotate)" || true
+    new="$("$NEW" --check $EDID_DECODE_OPTS "$edid" 2>&1 | annotate)" || true
+    [ "$old" = "$new" ] && return 0
+    diff <(echo "$old") <(echo "$new") | sed -n 's/^\([<>]\) /\1\t/p' |
+        sort -u | awk -F '\t' -v OFS='\t' -v edid="$edid" \
+            '{ print edid, $1 == "<" ? "-" : "+", $2, $3, $4 }'
+}
+export -f diff_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi > "$WORKDIR/list"
+
+xargs -0 -r -P "$JOBS" -n 64 -a "$WORKDIR/list" bash -c \
+    'out="$WORKDIR/records.$$"; for f; do diff_one "$f"; done >> "$out"' _
+cat "$WORKDIR"/records.* 2>/dev/null > "$WORKDIR/records.tsv" || true
+
+awk -F '\t' -v total="$(tr -cd '\0' < "$WORKDIR/list" | wc -c)" '
+{
+    edids[$1] = 1
+    if ($3 == "verdict") {
+        verdict[$1, $2] = $5
+        next
+    }
+    key = $3 "\t" $2 "\t" $4 "\t" $5
+    if ($3 == "decode")
+        key = "decode\t" $4
+    if (!((key, $1) in seen)) {
+        seen[key, $1] = 1
+        count[key]++
+        if (!(key in example)) {
+            example[key] = $1
+            line[key] = $5
+        }
+    }
+}
+END {
+    nd = 0
+    for (e in edids)
+        nd++
+    printf "EDIDs compared: %u\nEDIDs with differences: %u\n", total, nd
+    p2f = f2p = 0
+    for (e in edids) {
+        if (verdict[e, "-"] == "PASS" && verdict[e, "+"] == "FAIL")
+            p2f++
+        if (verdict[e, "-"] == "FAIL" && verdict[e, "+"] == "PASS")
+            f2p++
+    }
+    printf "Conformity PASS -> FAIL: %u\nConformity FAIL -> PASS: %u\n", p2f, f2p
+
+    print "\nWarnings and failures by message ID (count, change, data block, message, example):"
+    for (k in count) {
+        split(k, a, "\t")
+        if (a[1] == "warn" || a[1] == "fail")
+            printf "%8u  %s%s  %s: %s  [%s]\n", count[k], a[2],
+                   toupper(a[1]), a[3], a[4], example[k] | "sort -k1,1nr -k2"
+    }
+    close("sort -k1,1nr -k2")
+
+    print "\nDecode output changes by data block (count, block / data block, example):"
+    for (k in count) {
+        split(k, a, "\t")
+        if (a[1] == "decode")
+            printf "%8u  %s  [%s]: %s\n", count[k], a[2],
+                   example[k], line[k] | "sort -k1,1nr -k2"
+    }
+    close("sort -k1,1nr -k2")
+}' "$WORKDIR/records.tsv"
@@ -0,0 +1,108 @@
+#!/bin/bash -e
+
+# Distill a corpus of EDIDs to a small subset that exercises the same
+# decoder paths, for use as a regression corpus.
+#
+# Usage: edid-distill.sh <outdir> <edid>...
+#        find /path/to/corpus -type f | edid-distill.sh <outdir>
+#
+# Runs 'edid-decode --coverage' over every EDID in parallel ($JOBS jobs,
+# default: number of CPUs) to find the decoder paths it exercises: extension
+# blocks, CTA-861 and DisplayID data block tags, OUIs and warnings and
+# failures. A subset with the same coverage is then selected greedily:
+# for each path that is not yet covered, starting with the rarest, the EDID
+# with that path that exercises the most paths is selected.
+#
+# The selected EDIDs are copied to <outdir>, together with coverage.tsv
+# listing the paths of each selected EDID.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <outdir> [<edid>...]" >&2
+    exit 1
+fi
+OUT="$1"
+shift
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+export EDID_DECODE TMP
+
+# One line per path: edid <tab> path
+coverage_one() {
+    "$EDID_DECODE" --coverage "$1" 2>/dev/null |
+        awk -v edid="$1" '{ printf "%s\t%s\n", edid, $0 }'
+}
+export -f coverage_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 16 bash -c 'for f; do coverage_one "$f"; done > "$TMP/$$.$RANDOM.cov"' _
+
+find "$TMP" -name '*.cov' -exec cat {} + > "$TMP/coverage"
+
+# Sort the candidates: rarest path first, then the EDID with the most paths
+awk -F '\t' '
+NR == FNR {
+    num_paths[$1]++
+    num_edids[$2]++
+    next
+}
+{
+    printf "%u\t%u\t%s\t%s\n", num_edids[$2], num_paths[$1], $2, $1
+}' "$TMP/coverage" "$TMP/coverage" |
+    LC_ALL=C sort -t "$(printf '\t')" -k1,1n -k3,3 -k2,2nr -k4,4 > "$TMP/candidates"
+
+awk -F '\t' '
+NR == FNR {
+    edid_paths[$1] = edid_paths[$1] "\n" $2
+    next
+}
+!($3 in covered) && !($4 in selected) {
+    selected[$4] = 1
+    print $4
+    n = split(substr(edid_paths[$4], 2), p, "\n")
+    for (i = 1; i <= n; i++)
+        covered[p[i]] = 1
+}' "$TMP/coverage" "$TMP/candidates" > "$TMP/selected"
+
+mkdir -p "$OUT"
+while IFS= read -r edid; do
+    name="$(basename "$edid")"
+    i=1
+    while [ -e "$OUT/$name" ]; do
+        name="$(basename "$edid").$i"
+        i=$((i + 1))
+    done
+    cp "$edid" "$OUT/$name"
+    printf '%s\t%s\n' "$edid" "$name"
+done < "$TMP/selected" > "$TMP/names"
+
+awk -F '\t' '
+NR == FNR {
+    name[$1] = $2
+    next
+}
+$1 in name {
+    printf "%s\t%s\n", name[$1], $2
+}' "$TMP/names" "$TMP/coverage" > "$OUT/coverage.tsv"
+
+printf '%u of %u EDIDs selected, covering %u decoder paths\n' \
+    "$(wc -l < "$TMP/selected")" \
+    "$(cut -f 1 "$TMP/coverage" | LC_ALL=C sort -u | wc -l)" \
+    "$(cut -f 2 "$TMP/coverage" | LC_ALL=C sort -u | wc -l)" >&2
@@ -0,0 +1,87 @@
+#!/bin/bash -e
+
+# Fix the mechanical conformance failures of a corpus of EDIDs.
+#
+# Usage: edid-fix.sh <outdir> <edid>...
+#        find /path/to/corpus -type f | edid-fix.sh <outdir>
+#
+# Every EDID is fixed with 'edid-decode --fix $FIXES' (default: all) and
+# written in raw format to <outdir>, using the name of the EDID file. The
+# EDIDs are processed in parallel ($JOBS jobs, default: number of CPUs).
+# <outdir>/report.tsv lists the fixes applied to each EDID and its
+# conformity before and after, and a summary is printed per fix.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+FIXES=${FIXES:-all}
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <outdir> [<edid>...]" >&2
+    exit 1
+fi
+
+OUTDIR="$1"
+shift
+mkdir -p "$OUTDIR/.report"
+
+export EDID_DECODE OUTDIR FIXES
+
+# Fix one EDID and write its report line:
+# name <tab> fixes <tab> conformity before <tab> conformity after
+fix_one() {
+    local edid="$1"
+    local name
+    name="$(basename "$edid")"
+    local before log applied after
+
+    before="$("$EDID_DECODE" --check --skip-hex-dump "$edid" 2>/dev/null |
+        sed -n 's/^EDID conformity: *//p')" || true
+    log="$("$EDID_DECODE" --fix "$FIXES" -o raw "$edid" "$OUTDIR/$name" 2>&1)" || true
+    applied="$(sed -n 's/^Applied fixes: *//p' <<< "$log")"
+    after="$(sed -n 's/^EDID conformity after fixes: *//p' <<< "$log")"
+    printf '%s\t%s\t%s\t%s\n' "$name" "${applied:-error}" "${before:-error}" \
+        "${after:-error}" > "$OUTDIR/.report/$name"
+}
+export -f fix_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 32 bash -c 'for f; do fix_one "$f"; done' _
+
+find "$OUTDIR/.report" -type f -exec cat {} + | sort > "$OUTDIR/report.tsv"
+rm -rf "$OUTDIR/.report"
+
+awk -F '\t' '
+{
+    total++
+    if ($2 != "none" && $2 != "error")
+        fixed++
+    if ($3 == "FAIL" && $4 == "PASS")
+        passed++
+    if ($2 == "error")
+        errors++
+    n = split($2, names, ", ")
+    for (i = 1; i <= n; i++)
+        if (names[i] != "none" && names[i] != "error")
+            count[names[i]]++
+}
+END {
+    printf "EDIDs: %u\nEDIDs fixed: %u\nEDIDs now passing: %u\nErrors: %u\n",
+           total, fixed, passed, errors
+    for (name in count)
+        printf "%8u  %s\n", count[name], name | "sort -k1,1nr"
+}' "$OUTDIR/report.tsv"
+echo "Report written to $OUTDIR/report.tsv"
@@ -0,0 +1,115 @@
+#!/bin/bash -e
+
+# Group the EDIDs of a fleet into physical devices and report the
+# capability inconsistencies between the inputs of each device.
+#
+# Usage: edid-group.sh <edid>...
+#        find /path/to/fleet -type f | edid-group.sh
+#
+# Runs 'edid-decode --identity' over every EDID in parallel ($JOBS jobs,
+# default: number of CPUs), then sorts the identities by device key with
+# sort(1), which spills to disk ($TMPDIR) once it uses $SORT_MEM (default:
+# 25% of the memory). The sorted identities are read one device at a time,
+# so the memory use does not depend on the number of EDIDs.
+#
+# For every device with more than one distinct EDID, the EDIDs are listed
+# together with the capabilities that differ between them. Identical EDIDs
+# are only counted once.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+SORT_MEM=${SORT_MEM:-25%}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+export EDID_DECODE TMP
+
+# One line per EDID: edid <tab> edid-decode --identity output
+identity_one() {
+    local id
+
+    id="$("$EDID_DECODE" --identity "$1" 2>/dev/null)" && printf '%s\t%s\n' "$1" "$id"
+}
+export -f identity_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 64 bash -c 'for f; do identity_one "$f"; done > "$TMP/$$.$RANDOM.id"' _
+
+find "$TMP" -name '*.id' -exec cat {} + |
+    LC_ALL=C sort -t "$(printf '\t')" -k2,2 -k8 -S "$SORT_MEM" -T "${TMPDIR:-/tmp}" |
+    awk -F '\t' '
+    # Fields: 1 edid, 2 device key, 3 identity, 4 Container ID, 5 serial string,
+    # 6 tile ID, 7 serial number, 8 and up capabilities
+    function flush(    i, j, f, n, name, differs, line) {
+        if (num_edids > 1 && num_distinct > 1) {
+            devices++
+            printf "Device %s (%s): %u EDIDs\n", key, identity, num_edids
+            for (i = 1; i <= num_distinct; i++)
+                printf "  %s\n", edid[i]
+            for (f = 8; f <= max_field; f++) {
+                differs = 0
+                for (i = 2; i <= num_distinct; i++)
+                    if (cap[i, f] != cap[1, f])
+                        differs = 1
+                if (!differs)
+                    continue
+                name = cap[1, f]
+                sub(/=.*/, "", name)
+                printf "  %s differs:\n", name
+                for (i = 1; i <= num_distinct; i++) {
+                    line = cap[i, f]
+                    sub(/^[^=]*=/, "", line)
+                    printf "    %-20s %s\n", line, edid[i]
+                }
+            }
+            printf "\n"
+        }
+        split("", cap)
+        split("", edid)
+        num_edids = num_distinct = max_field = 0
+    }
+    $2 == "-" {
+        no_identity++
+        next
+    }
+    $2 != key {
+        flush()
+        key = $2
+        identity = $3
+        groups++
+    }
+    {
+        num_edids++
+        caps = $8
+        for (f = 9; f <= NF; f++)
+            caps = caps "\t" $f
+        # The lines are sorted on the capabilities within a device
+        if (num_distinct && caps == last_caps)
+            next
+        last_caps = caps
+        num_distinct++
+        edid[num_distinct] = $1
+        for (f = 8; f <= NF; f++)
+            cap[num_distinct, f] = $f
+        if (NF > max_field)
+            max_field = NF
+    }
+    END {
+        flush()
+        printf "%u devices, %u with inconsistent inputs, %u EDIDs without an identity\n",
+            groups, devices, no_identity > "/dev/stderr"
+    }'
@@ -0,0 +1,147 @@
+#!/bin/bash -e
+
+# Generate a static, cross-linked HTML report for a batch of EDIDs.
+#
+# Usage: edid-html-report.sh <outdir> <edid>...
+#        find /path/to/corpus -type f | edid-html-report.sh <outdir>
+#
+# One page is written per EDID (named after the EDID file) plus index pages
+# sorted by vendor, model, conformity and capabilities. The pages are
+# rendered with the bundled markdeep.min.js, which is copied only once into
+# <outdir> and shared by all pages.
+#
+# EDIDs are decoded in parallel ($JOBS jobs, default: number of CPUs), and
+# pages that are newer than both their EDID and the edid-decode binary are
+# not regenerated, so refreshing a large site only decodes what changed.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <outdir> [<edid>...]" >&2
+    exit 1
+fi
+
+OUTDIR="$1"
+shift
+mkdir -p "$OUTDIR/.summary"
+cp "$MISCDIR/markdeep.min.js" "$MISCDIR/markdeep-license.txt" "$OUTDIR"
+
+export EDID_DECODE OUTDIR MISCDIR
+
+# Render the page for one EDID and write its one-line summary:
+# name <tab> vendor <tab> model <tab> conformity <tab> capabilities
+render_one() {
+    local edid="$1"
+    local name
+    name="$(basename "$edid")"
+    local page="$OUTDIR/$name.html"
+    local summary="$OUTDIR/.summary/$name"
+
+    if [ "$page" -nt "$edid" ] && [ "$page" -nt "$EDID_DECODE" ] && [ -f "$summary" ]; then
+        return 0
+    fi
+
+    local txt
+    txt="$("$EDID_DECODE" --check --skip-sha --native-timings --preferred-timings "$edid" 2>&1)" || true
+
+    local vendor model conformity caps
+    vendor="$(sed -n 's/^ *Manufacturer: *//p' <<< "$txt" | head -n 1)"
+    model="$(sed -n 's/^ *Model: *//p' <<< "$txt" | head -n 1)"
+    conformity="$(sed -n 's/^EDID conformity: *//p' <<< "$txt")"
+    caps=""
+    grep -q "^Block [0-9]*, CTA-861 Extension Block" <<< "$txt" && caps="$caps CTA-861"
+    grep -q "^Block [0-9]*, DisplayID Extension Block" <<< "$txt" && caps="$caps DisplayID"
+    grep -q "Vendor-Specific Data Block (HDMI)" <<< "$txt" && caps="$caps HDMI"
+    grep -q "Vendor-Specific Data Block (HDMI Forum)\|HDMI Forum Sink Capability" <<< "$txt" && caps="$caps HDMI-2.x"
+    grep -q "HDR Static Metadata Data Block" <<< "$txt" && caps="$caps HDR"
+    grep -q "Vendor-Specific Video Data Block (Dolby)" <<< "$txt" && caps="$caps Dolby-Vision"
+    grep -q "YCbCr 4:2:0" <<< "$txt" && caps="$caps YCbCr-4:2:0"
+    grep -q "^  Audio Data Block" <<< "$txt" && caps="$caps Audio"
+    grep -q "Tiled Display Topology" <<< "$txt" && caps="$caps Tiled"
+    caps="${caps# }"
+
+    {
+        echo "<meta charset=\"utf-8\">"
+        echo "**$name**"
+        echo
+        echo "[Index](index.html) - [By vendor](by-vendor.html) - [By model](by-model.html) -"
+        echo "[By conformity](by-conformity.html) - [By capability](by-capability.html)"
+        echo
+        echo "Vendor | Model | Conformity | Capabilities"
+        echo "-------|-------|------------|-------------"
+        echo "[${vendor:-?}](by-vendor.html#${vendor:-unknown}) | ${model:-?} | ${conformity:-?} | ${caps:--}"
+        echo
+        echo '```none'
+        sed -e 's/&/\&amp;/g' -e 's/</\&lt;/g' -e 's/>/\&gt;/g' <<< "$txt"
+        echo '```'
+        cat "$MISCDIR/markdeep-footer"
+    } > "$page.tmp"
+    mv "$page.tmp" "$page"
+    printf '%s\t%s\t%s\t%s\t%s\n' "$name" "${vendor:-unknown}" "${model:-unknown}" \
+        "${conformity:-unknown}" "$caps" > "$summary"
+}
+export -f render_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 32 bash -c 'for f; do render_one "$f"; done' _
+
+SUMMARY="$OUTDIR/.summary.tsv"
+find "$OUTDIR/.summary" -type f -exec cat {} + | sort > "$SUMMARY"
+
+# Write an index page that groups the summary on the given column.
+# $1: page name, $2: title, $3: column to group on (0 for no grouping)
+write_index() {
+    {
+        echo "<meta charset=\"utf-8\">"
+        echo "**$2**"
+        echo
+        echo "[Index](index.html) - [By vendor](by-vendor.html) - [By model](by-model.html) -"
+        echo "[By conformity](by-conformity.html) - [By capability](by-capability.html)"
+        echo
+        echo "$(wc -l < "$SUMMARY") EDIDs."
+        echo
+        if [ "$3" = 5 ]; then
+            # An EDID is listed once for each capability it has
+            awk -F '\t' '{ n = split($5, c, " "); if (!n) print "none\t" $0;
+                for (i = 1; i <= n; i++) print c[i] "\t" $0 }' "$SUMMARY"
+        elif [ "$3" != 0 ]; then
+            awk -F '\t' -v col="$3" '{ print $col "\t" $0 }' "$SUMMARY"
+        else
+            awk -F '\t' '{ print "\t" $0 }' "$SUMMARY"
+        fi | sort -t "$(printf '\t')" -k1,1 -k2,2 | awk -F '\t' '
+            $1 != group || NR == 1 {
+                group = $1
+                if (group != "") {
+                    printf "\n<a name=\"%s\"></a>\n# %s\n\n", group, group
+                }
+                print "EDID | Vendor | Model | Conformity | Capabilities"
+                print "-----|--------|-------|------------|-------------"
+            }
+            { printf "[%s](%s.html) | %s | %s | %s | %s\n", $2, $2, $3, $4, $5, $6 }'
+        cat "$MISCDIR/markdeep-footer"
+    } > "$OUTDIR/$1.tmp"
+    mv "$OUTDIR/$1.tmp" "$OUTDIR/$1"
+}
+
+write_index index.html "EDID report" 0
+write_index by-vendor.html "EDIDs by vendor" 2
+write_index by-model.html "EDIDs by model" 3
+write_index by-conformity.html "EDIDs by conformity" 4
+write_index by-capability.html "EDIDs by capability" 5
+
+echo "Report written to $OUTDIR/index.html"
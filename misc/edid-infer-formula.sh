@@ -0,0 +1,80 @@
+#!/bin/bash -e
+
+# Identify which formula variants the vendors of a corpus of EDIDs use.
+#
+# Usage: edid-infer-formula.sh <edid>... > report.tsv
+#        find /path/to/corpus -type f | edid-infer-formula.sh > report.tsv
+#
+# Runs 'edid-decode --infer-formula' over every EDID in parallel ($JOBS jobs,
+# default: number of CPUs) and writes one line per DTD to stdout:
+#
+#   edid <tab> manufacturer <tab> DTD <tab> formula <tab> exact|approx|table|none
+#
+# A summary of the formulas per manufacturer is written to stderr.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+export EDID_DECODE TMP
+
+# Infer the formulas of one EDID, the formula is the first part of the
+# flags of each DTD line without the refresh rate.
+infer_one() {
+    local edid="$1"
+    local mfg
+
+    mfg="$("$EDID_DECODE" --skip-hex-dump "$edid" 2>/dev/null |
+        sed -n 's/^ *Manufacturer: *\([A-Z@]*\).*/\1/p' | head -n 1)"
+    "$EDID_DECODE" --infer-formula "$edid" 2>/dev/null |
+        sed -n 's/^  \(DTD *[0-9]*\): .*(\(.*\))$/\1\t\2/p' |
+        awk -F '\t' -v edid="$edid" -v mfg="${mfg:-unknown}" '
+        {
+            dtd = $1
+            sub(/ +/, " ", dtd)
+            formula = $2
+            kind = "approx"
+            if (formula ~ /, exact$/)
+                kind = "exact"
+            else if (formula ~ /not formula based$/)
+                kind = "table"
+            else if (formula == "no matching formula")
+                kind = "none"
+            sub(/,.*/, "", formula)
+            sub(/ [0-9.]+ (Hz|MHz)$/, "", formula)
+            sub(/ C.=.*/, "", formula)
+            if (kind == "table")
+                sub(/ .*/, "", formula)
+            printf "%s\t%s\t%s\t%s\t%s\n", edid, mfg, dtd, formula, kind
+        }'
+}
+export -f infer_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 16 bash -c 'for f; do infer_one "$f" > "$TMP/$$.$RANDOM.tsv"; done' _
+
+find "$TMP" -name '*.tsv' -exec cat {} + | LC_ALL=C sort > "$TMP/report"
+cat "$TMP/report"
+awk -F '\t' '
+{
+    count[$2 "\t" $4 " (" $5 ")"]++
+}
+END {
+    for (k in count)
+        printf "%s\t%u\n", k, count[k] | "LC_ALL=C sort -t \"\t\" -k1,1 -k3,3nr >&2"
+}' "$TMP/report"
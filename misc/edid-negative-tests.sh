@@ -0,0 +1,118 @@
+#!/bin/bash -e
+
+# Generate a labelled corpus of negative test EDIDs, each triggering a
+# single warning or failure, and check edid-decode against it.
+#
+# Usage: edid-negative-tests.sh <outdir> <seed>...
+#        find /path/to/seeds -type f | edid-negative-tests.sh <outdir>
+#        edid-negative-tests.sh --verify <outdir>
+#
+# Runs 'edid-decode --negative-tests' over every seed EDID in parallel
+# ($JOBS jobs, default: number of CPUs). Of all EDIDs that trigger a
+# diagnostic, the one from the seed with the fewest diagnostics of its own
+# and with the fewest edits is kept, so clean seeds give EDIDs that trigger
+# nothing but the target diagnostic.
+#
+# For each diagnostic (rule) <outdir> gets <rule>.edid and <rule>.diag,
+# which lists all diagnostics the EDID is expected to trigger in the
+# 'edid-decode --coverage' format. Edits that make edid-decode crash or hang
+# are kept as <outdir>/crash/<rule>.edid. <outdir>/rules.tsv lists the rule,
+# the seed diagnostic count, the edits, the seed and the target diagnostic.
+#
+# With --verify, every EDID in <outdir> is decoded again and the
+# diagnostics compared against <rule>.diag, and the EDIDs in <outdir>/crash
+# must decode without crashing or hanging.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+VERIFY=
+if [ "$1" = "--verify" ]; then
+    VERIFY=1
+    shift
+fi
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 [--verify] <outdir> [<seed>...]" >&2
+    exit 1
+fi
+OUT="$1"
+shift
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+export EDID_DECODE TMP
+
+diagnostics() {
+    "$EDID_DECODE" --coverage "$1" 2>/dev/null | grep '^warn \|^fail ' || true
+}
+export -f diagnostics
+
+if [ -n "$VERIFY" ]; then
+    # One line per EDID that does not match its labels
+    verify_one() {
+        if [ "$(basename "$(dirname "$1")")" = crash ]; then
+            timeout 10 "$EDID_DECODE" --coverage "$1" > /dev/null 2>&1 ||
+                [ $? -lt 124 ] || echo "$1"
+        else
+            diagnostics "$1" | cmp -s - "${1%.edid}.diag" || echo "$1"
+        fi
+    }
+    export -f verify_one
+
+    find "$OUT" -name '*.edid' -print0 |
+        xargs -0 -r -P "$JOBS" -n 64 bash -c 'for f; do verify_one "$f"; done' _ > "$TMP/failed"
+    if [ -s "$TMP/failed" ]; then
+        sed 's/^/Mismatch: /' "$TMP/failed" >&2
+        exit 1
+    fi
+    printf '%u negative tests passed\n' "$(find "$OUT" -name '*.edid' | wc -l)" >&2
+    exit 0
+fi
+
+# One line per EDID: the --negative-tests output plus the seed
+negative_one() {
+    mkdir -p "$TMP/edids"
+    "$EDID_DECODE" --negative-tests "$TMP/edids" "$1" 2>/dev/null |
+        awk -v seed="$1" '{ printf "%s\t%s\n", $0, seed }'
+}
+export -f negative_one
+
+if [ $# -gt 0 ]; then
+    printf '%s\0' "$@"
+else
+    tr '\n' '\0'
+fi | xargs -0 -r -P "$JOBS" -n 1 bash -c 'negative_one "$1" > "$TMP/$$.$RANDOM.neg"' _
+
+mkdir -p "$OUT/crash"
+# Fields: 1 rule, 2 seed diagnostics, 3 edits, 4 edit list, 5 file, 6 diagnostic, 7 seed
+find "$TMP" -name '*.neg' -exec cat {} + |
+    LC_ALL=C sort -t "$(printf '\t')" -k1,1 -k2,2n -k3,3n -k7,7 |
+    awk -F '\t' '$1 != rule { rule = $1; print }' > "$TMP/best"
+
+while IFS="$(printf '\t')" read -r rule seed_diags edits edit_list file diag seed; do
+    case "$diag" in
+    crash*|hang)
+        cp "$file" "$OUT/crash/$rule.edid"
+        ;;
+    *)
+        cp "$file" "$OUT/$rule.edid"
+        diagnostics "$OUT/$rule.edid" > "$OUT/$rule.diag"
+        ;;
+    esac
+    printf '%s\t%s\t%s\t%s\t%s\n' "$rule" "$seed_diags" "$edit_list" "$seed" "$diag"
+done < "$TMP/best" > "$OUT/rules.tsv"
+
+printf '%u rules, %u of them isolated from clean seeds, %u crashes or hangs\n' \
+    "$(wc -l < "$OUT/rules.tsv")" "$(awk -F '\t' '!$2' "$OUT/rules.tsv" | wc -l)" \
+    "$(find "$OUT/crash" -name '*.edid' | wc -l)" >&2
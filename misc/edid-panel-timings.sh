@@ -0,0 +1,84 @@
+#!/bin/bash -e
+
+# Generate the panel descriptions of a catalogue of panel EDIDs.
+#
+# Usage: edid-panel-timings.sh <out> <edid>...
+#        find /path/to/panels -type f | edid-panel-timings.sh <out>
+#
+# Runs 'edid-decode --panel-timings' over every EDID in parallel ($JOBS jobs,
+# default: number of CPUs) and writes all device tree display-timings nodes
+# to <out>.dtsi and all C tables to <out>.c, in the order of the EDIDs.
+# EDIDs without DTDs are skipped, as are panels with the same description
+# as an earlier panel. A different panel with the same identifier as an
+# earlier panel gets a numeric suffix, so no panel is dropped.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <out> [<edid>...]" >&2
+    exit 1
+fi
+OUT="$1"
+shift
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+JOBS=${JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+export EDID_DECODE TMP
+
+# Number the EDIDs so the output keeps their order
+if [ $# -gt 0 ]; then
+    printf '%s\n' "$@"
+else
+    cat
+fi | awk '{ printf "%08u\t%s\n", NR, $0 }' | tr '\n' '\0' > "$TMP/list"
+
+panel_one() {
+    local n="${1%%	*}" edid="${1#*	}"
+
+    "$EDID_DECODE" --panel-timings "dts=$TMP/$n.dts,c=$TMP/$n.c" "$edid" \
+        > /dev/null 2>&1 || rm -f "$TMP/$n.dts" "$TMP/$n.c"
+}
+export -f panel_one
+
+xargs -0 -r -P "$JOBS" -n 16 bash -c 'for f; do panel_one "$f"; done' _ < "$TMP/list"
+
+: > "$OUT.dtsi"
+: > "$OUT.c"
+declare -A seen
+for dts in $(find "$TMP" -name '*.dts' | LC_ALL=C sort); do
+    c="${dts%.dts}.c"
+    base="$(sed -n '1s,^/\* \(.*\) \*/$,\1,p' "$dts")"
+    name="$base"
+    k=1
+    # seen holds the descriptions as edid-decode wrote them, before renaming
+    while [ -n "${seen[$name]}" ] && ! cmp -s "${seen[$name]}" "$c"; do
+        k=$((k + 1))
+        name="${base}_$k"
+    done
+    [ -n "${seen[$name]}" ] && continue
+    seen[$name]="$c"
+    if [ $k -gt 1 ]; then
+        echo "Renaming panel $base to $name, the identifier is already used by another panel" >&2
+        sed -E "s/\<${base}(_|\>)/${name}\1/g" "$dts" >> "$OUT.dtsi"
+        sed -E "s/\<${base}(_|\>)/${name}\1/g" "$c" >> "$OUT.c"
+    else
+        cat "$dts" >> "$OUT.dtsi"
+        cat "$c" >> "$OUT.c"
+    fi
+    echo >> "$OUT.dtsi"
+    echo >> "$OUT.c"
+done
+
+printf '%u panels written to %s.dtsi and %s.c\n' "${#seen[@]}" "$OUT" "$OUT" >&2
@@ -0,0 +1,57 @@
+#!/bin/bash -e
+
+# Benchmark the cold start latency of edid-decode, as seen by a udev rule
+# that runs edid-decode for every hotplug.
+#
+# Usage: edid-startup-bench.sh [<edid>...]
+#
+# Runs 'edid-decode --startup-stats --check' $RUNS times (default: 20) for
+# every EDID (default: all EDIDs in data/), one process at a time, and reports
+# the median and 95th percentile of each --startup-stats time over all runs.
+# The time since main() is expected to stay below 1 ms.
+#
+# Set EDID_DECODE to use a specific edid-decode binary.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ -z "$EDID_DECODE" ]; then
+    if [ -x "$MISCDIR/../edid-decode" ]; then
+        EDID_DECODE="$MISCDIR/../edid-decode"
+    else
+        EDID_DECODE=edid-decode
+    fi
+fi
+EDID_DECODE="$(command -v "$EDID_DECODE")"
+RUNS=${RUNS:-20}
+TMP="$(mktemp -d)"
+trap 'rm -rf "$TMP"' EXIT
+
+if [ $# -eq 0 ]; then
+    set -- "$MISCDIR"/../data/*
+fi
+
+for edid in "$@"; do
+    for ((i = 0; i < RUNS; i++)); do
+        "$EDID_DECODE" --startup-stats --check "$edid" 2>&1 >/dev/null |
+            sed -n 's/^  \([^:]*\): *\([0-9.]*\) ms$/\1\t\2/p' >> "$TMP/stats" || true
+    done
+done
+
+if [ ! -s "$TMP/stats" ]; then
+    echo "No startup statistics found." >&2
+    exit 1
+fi
+
+printf '%-24s %10s %10s\n' "" "median" "p95"
+for stat in "CPU time before main()" "Option parsing" "Reading the EDID" \
+            "Decoding and output" "Total since main()" "Total CPU time"; do
+    awk -F '\t' -v stat="$stat" '$1 == stat { print $2 }' "$TMP/stats" |
+        LC_ALL=C sort -n |
+        awk -v stat="$stat" '
+        {
+            v[NR] = $1
+        }
+        END {
+            printf "%-24s %7.3f ms %7.3f ms\n", stat ":", v[int((NR + 1) / 2)], v[int((NR * 95 + 99) / 100)]
+        }'
+done
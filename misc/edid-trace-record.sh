@@ -0,0 +1,68 @@
+#!/bin/bash -e
+
+# Record a hotplug trace of the local DRM connectors for edid-decode --replay.
+#
+# Usage: edid-trace-record.sh <outdir>
+#
+# Every time a connector becomes connected or its EDID changes, the EDID
+# is stored once in <outdir>/edids/ (named after its SHA-1) and an event
+# is appended to <outdir>/trace. The connectors that are connected when
+# recording starts are recorded at time 0. Stop recording with Ctrl-C,
+# then replay the trace with:
+#
+#   edid-decode --replay 1 <outdir>/trace
+#
+# Connectors are rescanned on every DRM uevent if udevadm is available,
+# and every $POLL seconds (default 0.1) otherwise. Linux only.
+
+if [ $# -ne 1 ]; then
+    echo "Usage: $0 <outdir>" >&2
+    exit 1
+fi
+
+OUTDIR="$1"
+POLL=${POLL:-0.1}
+mkdir -p "$OUTDIR/edids"
+
+if ! ls /sys/class/drm/card*-*/edid > /dev/null 2>&1; then
+    echo "No DRM connectors found." >&2
+    exit 1
+fi
+
+declare -A last
+START="$(date +%s.%N)"
+TRACE="$OUTDIR/trace"
+echo "# edid-decode hotplug trace: $(hostname), $(date)" > "$TRACE"
+
+scan() {
+    local now conn sum status
+    now="$(date +%s.%N)"
+    for c in /sys/class/drm/card*-*; do
+        conn="$(basename "$c")"
+        status="$(cat "$c/status" 2>/dev/null)" || continue
+        if [ "$status" != connected ] || [ ! -s "$c/edid" ]; then
+            last[$conn]=""
+            continue
+        fi
+        sum="$(sha1sum < "$c/edid" | cut -d ' ' -f 1)"
+        [ "${last[$conn]}" = "$sum" ] && continue
+        last[$conn]="$sum"
+        [ -f "$OUTDIR/edids/$sum" ] || cp "$c/edid" "$OUTDIR/edids/$sum"
+        awk -v now="$now" -v start="$START" -v conn="$conn" -v edid="edids/$sum" \
+            'BEGIN { printf "%.6f %s %s\n", now - start, conn, edid }' >> "$TRACE"
+        echo "$conn: $sum" >&2
+    done
+}
+
+scan
+if command -v udevadm > /dev/null; then
+    udevadm monitor --kernel --subsystem-match=drm | while read -r line; do
+        case "$line" in
+        KERNEL*change*) scan ;;
+        esac
+    done
+else
+    while sleep "$POLL"; do
+        scan
+    done
+fi
@@ -0,0 +1,81 @@
+#!/bin/bash -e
+
+# Generate a synthetic hotplug trace for edid-decode --replay.
+#
+# Usage: edid-trace-synth.sh <scenario> <duration> [<edid>...] > trace
+#
+# The trace covers <duration> seconds and uses the given EDIDs, or all
+# EDIDs in data/ if none are given. EDID file names are written as
+# absolute paths, so the trace can be stored anywhere. Scenarios:
+#
+# - kvm:    a KVM switch with $HEADS heads (default 16) switches every
+#           $PERIOD seconds (default 2), and all heads see a hotplug
+#           within a few milliseconds of each other. Every head keeps
+#           its monitor.
+# - dock:   a dock with $HEADS heads (default 3) reconnects every $PERIOD
+#           seconds (default 5), and every head flaps one to five times
+#           within 300 ms.
+# - steady: independent hotplugs at $RATE events per second (default 50)
+#           on one of $HEADS connectors (default 64), each with a random
+#           EDID.
+#
+# Set SEED to get a different trace for the same parameters.
+
+MISCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 kvm|dock|steady <duration> [<edid>...]" >&2
+    exit 1
+fi
+
+SCENARIO="$1"
+DURATION="$2"
+shift 2
+
+case "$SCENARIO" in
+kvm)    HEADS=${HEADS:-16}; PERIOD=${PERIOD:-2} ;;
+dock)   HEADS=${HEADS:-3}; PERIOD=${PERIOD:-5} ;;
+steady) HEADS=${HEADS:-64}; RATE=${RATE:-50} ;;
+*)
+    echo "Unknown scenario '$SCENARIO'." >&2
+    exit 1
+    ;;
+esac
+
+if [ $# -eq 0 ]; then
+    set -- "$MISCDIR"/../data/*
+fi
+
+for f; do
+    echo "$(cd "$(dirname "$f")" && pwd)/$(basename "$f")"
+done | awk -v scenario="$SCENARIO" -v duration="$DURATION" -v heads="$HEADS" \
+    -v period="$PERIOD" -v rate="$RATE" -v seed="${SEED:-1}" '
+function event(t, head) {
+    if (t < duration)
+        printf "%.6f conn%u %s\n", t, head, edid[head]
+}
+{ edids[n++] = $0 }
+END {
+    srand(seed)
+    printf "# edid-decode hotplug trace: %s, %s s, seed %u\n", scenario, duration, seed
+    for (h = 0; h < heads; h++)
+        edid[h] = edids[int(rand() * n)]
+    if (scenario == "kvm") {
+        for (t = 0; t < duration; t += period)
+            for (h = 0; h < heads; h++)
+                event(t + rand() * 0.02, h)
+    } else if (scenario == "dock") {
+        for (t = 0; t < duration; t += period)
+            for (h = 0; h < heads; h++) {
+                flaps = 1 + int(rand() * 5)
+                for (i = 0; i < flaps; i++)
+                    event(t + i * 0.3 / flaps + rand() * 0.02, h)
+            }
+    } else {
+        for (t = -log(1 - rand()) / rate; t < duration; t += -log(1 - rand()) / rate) {
+            h = int(rand() * heads)
+            edid[h] = edids[int(rand() * n)]
+            event(t, h)
+        }
+    }
+}' | LC_ALL=C sort -n -k1,1
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Generate negative test EDIDs that each trigger a single diagnostic.
+ *
+ * Starting from a seed EDID, single byte edits are applied to every byte
+ * of every block: each bit flipped, 0x00, 0xff and the value plus and
+ * minus one. The checksums of the edited block (and of the DisplayID
+ * section in it) are updated, unless the edit is to a checksum. An edit
+ * isolates a diagnostic if the edited EDID has exactly the diagnostics of
+ * the seed plus that one.
+ *
+ * Edits that trigger a diagnostic together with others are steered using
+ * the provenance of the diagnostics, i.e. the blocks they were reported
+ * in: a second edit is tried in each of those blocks to get rid of the
+ * other diagnostics while keeping the target.
+ *
+ * The edited EDIDs are decoded in a child process, so an edit that makes
+ * the decoder crash or hang is reported as a "crash" or "hang" diagnostic
+ * instead of ending the run.
+ *
+ * For each isolated diagnostic the EDID with the fewest edits is written
+ * to <outdir>/<rule>.<seed>.edid, where <rule> is the FNV-1a hash of the
+ * diagnostic and <seed> that of the seed EDID, and a tab separated line
+ * is written to stdout: rule, number of seed diagnostics, number of
+ * edits, edits, file and diagnostic. misc/edid-negative-tests.sh selects
+ * the best EDID of each rule over all seeds.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+#include "edid-decode.h"
+
+// At most this many partial candidates per diagnostic get a second edit
+#define MAX_STEERED 2
+// Seconds a decode may take before it is considered to hang
+#define DECODE_TIMEOUT 2
+
+struct edit {
+	unsigned offset;
+	unsigned char value;
+};
+
+struct candidate {
+	std::vector<edit> edits;
+	unsigned extra;		// the number of other new diagnostics
+};
+
+static void update_checksums(unsigned char *edid, unsigned offset)
+{
+	unsigned char *x = edid + offset / EDID_PAGE_SIZE * EDID_PAGE_SIZE;
+	unsigned pos = offset % EDID_PAGE_SIZE;
+	unsigned char sum = 0;
+
+	if (x[0] == 0x70 && x[2] <= 121 && pos != 5u + x[2]) {
+		for (unsigned i = 1; i < 5u + x[2]; i++)
+			sum += x[i];
+		x[5 + x[2]] = -sum;
+		sum = 0;
+	}
+	if (pos == EDID_PAGE_SIZE - 1)
+		return;
+	for (unsigned i = 0; i < EDID_PAGE_SIZE - 1; i++)
+		sum += x[i];
+	x[EDID_PAGE_SIZE - 1] = -sum;
+}
+
+static std::vector<unsigned char> apply_edits(const std::vector<unsigned char> &seed,
+					      const std::vector<edit> &edits)
+{
+	std::vector<unsigned char> edid = seed;
+
+	for (const auto &e : edits) {
+		edid[e.offset] = e.value;
+		update_checksums(edid.data(), e.offset);
+	}
+	return edid;
+}
+
+// The values to try for a byte
+static std::vector<unsigned char> edit_values(unsigned char v)
+{
+	std::set<unsigned char> values;
+
+	for (unsigned b = 0; b < 8; b++)
+		values.insert(v ^ (1 << b));
+	values.insert(0x00);
+	values.insert(0xff);
+	values.insert(v + 1);
+	values.insert(v - 1);
+	values.erase(v);
+	return std::vector<unsigned char>(values.begin(), values.end());
+}
+
+static std::string edits2s(const std::vector<edit> &edits)
+{
+	std::string s;
+	char buf[32];
+
+	for (const auto &e : edits) {
+		sprintf(buf, "%s%u:0x%02x=0x%02x", s.empty() ? "" : ",",
+			e.offset / EDID_PAGE_SIZE, e.offset % EDID_PAGE_SIZE, e.value);
+		s += buf;
+	}
+	return s;
+}
+
+static diagnostics diagnose_child(diagnose_fn diagnose, const unsigned char *edid,
+				  unsigned num_blocks)
+{
+#ifdef _WIN32
+	return diagnose(edid, num_blocks);
+#else
+	diagnostics diags;
+	char line[1100];
+	int status = 0;
+	int fds[2];
+	pid_t pid;
+	FILE *f;
+
+	if (pipe(fds)) {
+		perror("pipe");
+		exit(EXIT_FAILURE);
+	}
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+	if (pid == 0) {
+		close(fds[0]);
+		alarm(DECODE_TIMEOUT);
+		diags = diagnose(edid, num_blocks);
+		f = fdopen(fds[1], "w");
+		for (const auto &d : diags)
+			fprintf(f, "%u\t%s\n", d.second, d.first.c_str());
+		fclose(f);
+		_exit(0);
+	}
+	close(fds[1]);
+	f = fdopen(fds[0], "r");
+	while (fgets(line, sizeof(line), f)) {
+		char *diag;
+		unsigned blk = strtoul(line, &diag, 10);
+
+		line[strcspn(line, "\n")] = 0;
+		if (*diag == '\t')
+			diags.insert({ diag + 1, blk });
+	}
+	fclose(f);
+	waitpid(pid, &status, 0);
+	if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+		diags = { { "hang", 0 } };
+	} else if (WIFSIGNALED(status)) {
+		sprintf(line, "crash signal %d", WTERMSIG(status));
+		diags = { { line, 0 } };
+	}
+	return diags;
+#endif
+}
+
+int negative_tests(const unsigned char *seed_edid, unsigned num_blocks, const char *outdir,
+		   diagnose_fn diagnose)
+{
+	std::vector<unsigned char> seed(seed_edid, seed_edid + num_blocks * EDID_PAGE_SIZE);
+	diagnostics seed_diags = diagnose_child(diagnose, seed.data(), num_blocks);
+	std::map<std::string, candidate> best;
+	std::map<std::string, std::vector<candidate>> partial;
+	std::map<std::string, std::set<unsigned>> provenance;
+
+	/*
+	 * Returns the new diagnostics, which must not include ones of the seed.
+	 * A crash or hang is a diagnostic of its own.
+	 */
+	auto try_edits = [&](const std::vector<edit> &edits) {
+		std::vector<unsigned char> edid = apply_edits(seed, edits);
+		diagnostics diags = diagnose_child(diagnose, edid.data(), num_blocks);
+		diagnostics added;
+
+		if (diags.size() == 1 && (diags.count("hang") ||
+					  diags.begin()->first.compare(0, 6, "crash ") == 0))
+			return diags;
+		for (const auto &d : seed_diags)
+			if (!diags.count(d.first))
+				return diagnostics();
+		for (const auto &d : diags)
+			if (!seed_diags.count(d.first))
+				added.insert(d);
+		return added;
+	};
+	auto record = [&](const std::vector<edit> &edits, const diagnostics &added) {
+		for (const auto &d : added) {
+			candidate c = { edits, (unsigned)added.size() - 1 };
+
+			if (c.extra) {
+				if (best.count(d.first))
+					continue;
+				// Keep the partial candidates with the fewest other diagnostics
+				auto &p = partial[d.first];
+				p.push_back(c);
+				std::stable_sort(p.begin(), p.end(),
+						 [](const candidate &a, const candidate &b) {
+							 return a.extra < b.extra;
+						 });
+				if (p.size() > MAX_STEERED)
+					p.pop_back();
+				for (const auto &o : added)
+					provenance[d.first].insert(o.second);
+			} else if (!best.count(d.first) ||
+				   best[d.first].edits.size() > edits.size()) {
+				best[d.first] = c;
+			}
+		}
+	};
+
+	for (unsigned offset = 0; offset < seed.size(); offset++) {
+		// Keep the EDID header, an EDID without it is not read at all
+		if (offset < 8)
+			continue;
+		for (auto v : edit_values(seed[offset])) {
+			std::vector<edit> edits = { { offset, v } };
+
+			record(edits, try_edits(edits));
+		}
+	}
+
+	for (const auto &p : partial) {
+		if (best.count(p.first))
+			continue;
+		for (const auto &c : p.second) {
+			for (auto blk : provenance[p.first]) {
+				// Diagnostics of the EDID as a whole are reported after the last block
+				blk = min(blk, num_blocks - 1);
+				for (unsigned offset = blk * EDID_PAGE_SIZE;
+				     offset < (blk + 1) * EDID_PAGE_SIZE && !best.count(p.first); offset++) {
+					if (offset < 8 || offset == c.edits[0].offset)
+						continue;
+					for (auto v : edit_values(seed[offset])) {
+						std::vector<edit> edits = c.edits;
+
+						edits.push_back({ offset, v });
+						diagnostics added = try_edits(edits);
+
+						if (added.size() == 1 && added.count(p.first)) {
+							record(edits, added);
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	char seed_id[17];
+
+	sprintf(seed_id, "%016llx", fnv1a_64(std::string(seed.begin(), seed.end())));
+	for (const auto &b : best) {
+		std::vector<unsigned char> edid = apply_edits(seed, b.second.edits);
+		char rule_id[17];
+		std::string file;
+		FILE *f;
+
+		sprintf(rule_id, "%016llx", fnv1a_64(b.first));
+		file = std::string(outdir) + "/" + rule_id + "." + seed_id + ".edid";
+		f = fopen(file.c_str(), "wb");
+		if (!f || fwrite(edid.data(), 1, edid.size(), f) != edid.size()) {
+			perror(file.c_str());
+			if (f)
+				fclose(f);
+			return -1;
+		}
+		fclose(f);
+		printf("%s\t%u\t%u\t%s\t%s\t%s\n", rule_id, (unsigned)seed_diags.size(),
+		       (unsigned)b.second.edits.size(), edits2s(b.second.edits).c_str(),
+		       file.c_str(), b.first.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Generate embedded panel descriptions from the DTDs.
+ *
+ * The output is a device tree display-timings node (see the Linux
+ * panel-timing.yaml binding) and/or C display_timing, drm_display_mode and
+ * panel-simple style panel_desc tables. The interface type, bit depth and
+ * signal polarities are taken from the EPI descriptor, the DI-EXT block
+ * and the EDID 1.4 video input definition, in that order of preference.
+ *
+ * The typical pixel clock is that of the DTD. The minimum and maximum
+ * pixel clock keep the DTD blanking and are limited by the Display Range
+ * Limits and the DI-EXT pixel clock range, so they give the refresh rate
+ * range the panel accepts.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "edid-view.h"
+
+struct panel_info {
+	std::string name;
+	unsigned bpc;
+	const char *bus_format;
+	const char *connector;
+	int de_high;		// -1 if unknown
+	int pixdata_posedge;	// -1 if unknown
+	unsigned max_pixclk_khz;	// 0 if unknown
+	unsigned min_pixclk_khz;
+	unsigned power_on_ms, power_off_ms;
+
+	panel_info() :
+		bpc(0), bus_format(NULL), connector(NULL), de_high(-1),
+		pixdata_posedge(-1), max_pixclk_khz(0), min_pixclk_khz(0),
+		power_on_ms(0), power_off_ms(0) {}
+};
+
+/*
+ * A C identifier derived from the product name, the PNP ID and the product
+ * code: the product name alone is often shared by different panels.
+ */
+static std::string panel_name(base_block_view base)
+{
+	std::string name;
+	char s[14];
+	char pnp[4];
+
+	for (unsigned i = 0; i < 4; i++)
+		if (base.descriptor(i).tag() == 0xfc)
+			name = base.descriptor(i).string(s);
+	snprintf(s, sizeof(s), "%s_%04x", base.manufacturer(pnp), base.product());
+	name = name.empty() ? s : name + "_" + s;
+	for (auto &c : name)
+		c = isalnum(c) ? tolower(c) : '_';
+	if (!isalpha(name[0]))
+		name = "panel_" + name;
+	return name;
+}
+
+// EPI descriptor, see VESA EPI 1.0
+static void parse_epi(panel_info &p, descriptor_view d)
+{
+	static const unsigned bpc[] = { 6, 8, 10 };
+	byte_view x = d.x;
+	bool jeida = x[5] & 0x60;
+
+	if ((x[5] & 0x07) <= 2)
+		p.bpc = bpc[x[5] & 0x07];
+	switch (x[6] & 0x0f) {
+	case 0x00:
+		p.connector = "LVDS";
+		if (p.bpc == 6)
+			p.bus_format = "MEDIA_BUS_FMT_RGB666_1X7X3_SPWG";
+		else if (p.bpc == 8)
+			p.bus_format = jeida ? "MEDIA_BUS_FMT_RGB888_1X7X4_JEIDA" :
+				"MEDIA_BUS_FMT_RGB888_1X7X4_SPWG";
+		break;
+	case 0x03:
+		p.connector = "DPI";
+		p.bus_format = "MEDIA_BUS_FMT_RGB666_1X18";
+		break;
+	case 0x04:
+		p.connector = "DPI";
+		p.bus_format = "MEDIA_BUS_FMT_RGB888_1X24";
+		break;
+	case 0x05:
+		p.connector = "DVID";
+		break;
+	}
+	p.de_high = !(x[6] & 0x10);
+	p.pixdata_posedge = !(x[6] & 0x20);
+	p.power_on_ms = (x[8] & 0x0f) * 10;
+	p.power_off_ms = (x[8] >> 4) * 10;
+}
+
+// DI-EXT Digital Interface section
+static void parse_di_ext(panel_info &p, byte_view x)
+{
+	unsigned links = 1;
+
+	switch (x[2]) {
+	case 0x01: case 0x02: case 0x05: case 0x07:
+		p.connector = p.connector ? p.connector : "DVID";
+		break;
+	case 0x03: case 0x04:
+		p.connector = p.connector ? p.connector : "DVID";
+		links = 2;
+		break;
+	case 0x08: case 0x0a:
+		p.connector = p.connector ? p.connector : "LVDS";
+		break;
+	case 0x09:
+		p.connector = p.connector ? p.connector : "LVDS";
+		links = 2;
+		break;
+	default:
+		return;
+	}
+	if (p.de_high < 0 && (x[7] & 0x80))
+		p.de_high = !!(x[7] & 0x40);
+	if (p.pixdata_posedge < 0 && ((x[7] >> 4) & 0x03) == 1)
+		p.pixdata_posedge = 1;
+	else if (p.pixdata_posedge < 0 && ((x[7] >> 4) & 0x03) == 2)
+		p.pixdata_posedge = 0;
+	if (!p.bpc && (x[8] == 0x15 || x[8] == 0x24 || x[8] == 0x48))
+		p.bpc = 8;
+	else if (!p.bpc && (x[8] == 0x19 || x[8] == 0x49))
+		p.bpc = 12;
+	if (x[9] && x[9] != 0xff)
+		p.min_pixclk_khz = x[9] * 1000;
+	if (x.le16(10) && x.le16(10) != 0xffff)
+		p.max_pixclk_khz = x.le16(10) * 1000 * links;
+}
+
+static panel_info parse_panel_info(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	base_block_view base = e.base();
+	panel_info p;
+
+	p.name = panel_name(base);
+	for (unsigned i = 0; i < 4; i++)
+		if (base.descriptor(i).tag() == 0x0e)
+			parse_epi(p, base.descriptor(i));
+	for (auto blk : e.extensions())
+		if (blk.tag() == 0x40)
+			parse_di_ext(p, blk.x);
+
+	// EDID 1.4 video input definition
+	unsigned char input = base.x[0x14];
+
+	if (base.version() == 1 && base.revision() >= 4 && (input & 0x80)) {
+		unsigned depth = (input >> 4) & 0x07;
+
+		if (!p.bpc && depth >= 1 && depth <= 6)
+			p.bpc = 4 + 2 * depth;
+		if (!p.connector && (input & 0x0f) == 0x05)
+			p.connector = "eDP";
+		else if (!p.connector && (input & 0x0f) == 0x01)
+			p.connector = "DVID";
+	}
+	return p;
+}
+
+struct panel_range {
+	unsigned min, typ, max;
+};
+
+// The pixel clock range in kHz that keeps the blanking of the DTD
+static panel_range pixclk_range(const edid_state &state, const timings &t,
+				unsigned min_khz, unsigned max_khz)
+{
+	unsigned htotal = t.hact + t.hfp + t.hsync + t.hbp;
+	unsigned vtotal = t.vact + t.vfp + t.vsync + t.vbp;
+	unsigned long long frame = (unsigned long long)htotal * vtotal;
+	panel_range r = { t.pixclk_khz, t.pixclk_khz, t.pixclk_khz };
+
+	if (t.interlaced)
+		frame /= 2;
+	if (state.base.max_display_vert_freq_hz) {
+		r.min = max((unsigned long long)min_khz,
+			    max(frame * state.base.min_display_vert_freq_hz / 1000,
+				(unsigned long long)htotal * state.base.min_display_hor_freq_hz / 1000));
+		r.max = min(frame * state.base.max_display_vert_freq_hz / 1000,
+			    (unsigned long long)htotal * state.base.max_display_hor_freq_hz / 1000);
+		if (state.base.max_display_pixclk_khz)
+			r.max = min(r.max, state.base.max_display_pixclk_khz);
+	} else {
+		r.min = max(r.min, min_khz);
+	}
+	if (max_khz)
+		r.max = min(r.max, max_khz);
+	// Never exclude the DTD itself
+	r.min = min(r.min, r.typ);
+	r.max = max(r.max, r.typ);
+	return r;
+}
+
+static void print_dts(FILE *f, const panel_info &p, const vec_timings_ext &dtds,
+		      const std::vector<panel_range> &clks)
+{
+	fprintf(f, "/* %s */\n", p.name.c_str());
+	fprintf(f, "display-timings {\n");
+	fprintf(f, "\tnative-mode = <&%s_timing0>;\n\n", p.name.c_str());
+	for (unsigned i = 0; i < dtds.size(); i++) {
+		const timings &t = dtds[i].t;
+		const panel_range &r = clks[i];
+
+		fprintf(f, "\t%s_timing%u: timing%u {\n", p.name.c_str(), i, i);
+		if (r.min == r.max)
+			fprintf(f, "\t\tclock-frequency = <%u>;\n", r.typ * 1000);
+		else
+			fprintf(f, "\t\tclock-frequency = <%u %u %u>;\n",
+				r.min * 1000, r.typ * 1000, r.max * 1000);
+		fprintf(f, "\t\thactive = <%u>;\n", t.hact);
+		fprintf(f, "\t\tvactive = <%u>;\n", t.vact);
+		fprintf(f, "\t\thfront-porch = <%u>;\n", t.hfp);
+		fprintf(f, "\t\thback-porch = <%u>;\n", t.hbp);
+		fprintf(f, "\t\thsync-len = <%u>;\n", t.hsync);
+		fprintf(f, "\t\tvfront-porch = <%u>;\n", t.vfp);
+		fprintf(f, "\t\tvback-porch = <%u>;\n", t.vbp);
+		fprintf(f, "\t\tvsync-len = <%u>;\n", t.vsync);
+		fprintf(f, "\t\thsync-active = <%u>;\n", t.pos_pol_hsync);
+		if (!t.no_pol_vsync)
+			fprintf(f, "\t\tvsync-active = <%u>;\n", t.pos_pol_vsync);
+		if (p.de_high >= 0)
+			fprintf(f, "\t\tde-active = <%u>;\n", p.de_high);
+		if (p.pixdata_posedge >= 0)
+			fprintf(f, "\t\tpixelclk-active = <%u>;\n", p.pixdata_posedge);
+		if (t.interlaced)
+			fprintf(f, "\t\tinterlaced;\n");
+		fprintf(f, "\t};\n");
+	}
+	fprintf(f, "};\n");
+}
+
+static void add_flag(std::string &flags, const char *flag)
+{
+	if (!flags.empty())
+		flags += " | ";
+	flags += flag;
+}
+
+static void print_c_range(FILE *f, const char *field, unsigned min, unsigned typ, unsigned max)
+{
+	fprintf(f, "\t\t.%s = { %u, %u, %u },\n", field, min, typ, max);
+}
+
+static void print_c(FILE *f, const panel_info &p, const vec_timings_ext &dtds,
+		    const std::vector<panel_range> &clks, unsigned width_mm, unsigned height_mm)
+{
+	const char *name = p.name.c_str();
+
+	fprintf(f, "static const struct display_timing %s_timings[] = {\n", name);
+	for (unsigned i = 0; i < dtds.size(); i++) {
+		const timings &t = dtds[i].t;
+		const panel_range &r = clks[i];
+		std::string flags;
+
+		fprintf(f, "\t{\n");
+		print_c_range(f, "pixelclock", r.min * 1000, r.typ * 1000, r.max * 1000);
+		print_c_range(f, "hactive", t.hact, t.hact, t.hact);
+		print_c_range(f, "hfront_porch", t.hfp, t.hfp, t.hfp);
+		print_c_range(f, "hback_porch", t.hbp, t.hbp, t.hbp);
+		print_c_range(f, "hsync_len", t.hsync, t.hsync, t.hsync);
+		print_c_range(f, "vactive", t.vact, t.vact, t.vact);
+		print_c_range(f, "vfront_porch", t.vfp, t.vfp, t.vfp);
+		print_c_range(f, "vback_porch", t.vbp, t.vbp, t.vbp);
+		print_c_range(f, "vsync_len", t.vsync, t.vsync, t.vsync);
+		add_flag(flags, t.pos_pol_hsync ? "DISPLAY_FLAGS_HSYNC_HIGH" :
+		       "DISPLAY_FLAGS_HSYNC_LOW");
+		if (!t.no_pol_vsync)
+			add_flag(flags, t.pos_pol_vsync ? "DISPLAY_FLAGS_VSYNC_HIGH" :
+			       "DISPLAY_FLAGS_VSYNC_LOW");
+		if (p.de_high >= 0)
+			add_flag(flags, p.de_high ? "DISPLAY_FLAGS_DE_HIGH" :
+			       "DISPLAY_FLAGS_DE_LOW");
+		if (p.pixdata_posedge >= 0)
+			add_flag(flags, p.pixdata_posedge ? "DISPLAY_FLAGS_PIXDATA_POSEDGE" :
+			       "DISPLAY_FLAGS_PIXDATA_NEGEDGE");
+		if (t.interlaced)
+			add_flag(flags, "DISPLAY_FLAGS_INTERLACED");
+		fprintf(f, "\t\t.flags = %s,\n", flags.c_str());
+		fprintf(f, "\t},\n");
+	}
+	fprintf(f, "};\n\n");
+
+	fprintf(f, "static const struct drm_display_mode %s_modes[] = {\n", name);
+	for (const auto &te : dtds) {
+		const timings &t = te.t;
+		std::string flags;
+
+		fprintf(f, "\t{\n");
+		fprintf(f, "\t\t.clock = %u,\n", t.pixclk_khz);
+		fprintf(f, "\t\t.hdisplay = %u,\n", t.hact);
+		fprintf(f, "\t\t.hsync_start = %u + %u,\n", t.hact, t.hfp);
+		fprintf(f, "\t\t.hsync_end = %u + %u + %u,\n", t.hact, t.hfp, t.hsync);
+		fprintf(f, "\t\t.htotal = %u + %u + %u + %u,\n", t.hact, t.hfp, t.hsync, t.hbp);
+		fprintf(f, "\t\t.vdisplay = %u,\n", t.vact);
+		fprintf(f, "\t\t.vsync_start = %u + %u,\n", t.vact, t.vfp);
+		fprintf(f, "\t\t.vsync_end = %u + %u + %u,\n", t.vact, t.vfp, t.vsync);
+		fprintf(f, "\t\t.vtotal = %u + %u + %u + %u,\n", t.vact, t.vfp, t.vsync, t.vbp);
+		add_flag(flags, t.pos_pol_hsync ? "DRM_MODE_FLAG_PHSYNC" :
+		       "DRM_MODE_FLAG_NHSYNC");
+		if (!t.no_pol_vsync)
+			add_flag(flags, t.pos_pol_vsync ? "DRM_MODE_FLAG_PVSYNC" :
+			       "DRM_MODE_FLAG_NVSYNC");
+		if (t.interlaced)
+			add_flag(flags, "DRM_MODE_FLAG_INTERLACE");
+		fprintf(f, "\t\t.flags = %s,\n", flags.c_str());
+		fprintf(f, "\t},\n");
+	}
+	fprintf(f, "};\n\n");
+
+	std::string bus_flags;
+
+	fprintf(f, "static const struct panel_desc %s = {\n", name);
+	fprintf(f, "\t.timings = %s_timings,\n", name);
+	fprintf(f, "\t.num_timings = ARRAY_SIZE(%s_timings),\n", name);
+	if (p.bpc)
+		fprintf(f, "\t.bpc = %u,\n", p.bpc);
+	if (width_mm && height_mm)
+		fprintf(f, "\t.size = {\n\t\t.width = %u,\n\t\t.height = %u,\n\t},\n",
+			width_mm, height_mm);
+	if (p.power_on_ms || p.power_off_ms) {
+		fprintf(f, "\t.delay = {\n");
+		if (p.power_on_ms)
+			fprintf(f, "\t\t.prepare = %u,\n", p.power_on_ms);
+		if (p.power_off_ms)
+			fprintf(f, "\t\t.unprepare = %u,\n", p.power_off_ms);
+		fprintf(f, "\t},\n");
+	}
+	if (p.bus_format)
+		fprintf(f, "\t.bus_format = %s,\n", p.bus_format);
+	if (p.de_high >= 0)
+		add_flag(bus_flags, p.de_high ? "DRM_BUS_FLAG_DE_HIGH" :
+		       "DRM_BUS_FLAG_DE_LOW");
+	if (p.pixdata_posedge >= 0)
+		add_flag(bus_flags, p.pixdata_posedge ? "DRM_BUS_FLAG_PIXDATA_DRIVE_POSEDGE" :
+		       "DRM_BUS_FLAG_PIXDATA_DRIVE_NEGEDGE");
+	if (!bus_flags.empty())
+		fprintf(f, "\t.bus_flags = %s,\n", bus_flags.c_str());
+	if (p.connector)
+		fprintf(f, "\t.connector_type = DRM_MODE_CONNECTOR_%s,\n", p.connector);
+	fprintf(f, "};\n");
+}
+
+/*
+ * Write the device tree node to dts_file and the C tables to c_file,
+ * either can be NULL to skip it or "-" for stdout.
+ */
+int edid_state::panel_timings(const unsigned char *edid, const char *dts_file,
+			      const char *c_file)
+{
+	panel_info p = parse_panel_info(edid, num_blocks);
+	vec_timings_ext dtds;
+	std::vector<panel_range> clks;
+
+	for (auto te : cta.vec_dtds) {
+		if (!te.is_valid() || te.t.ycbcr420)
+			continue;
+		// Panels have no borders, count them as part of the porches
+		te.t.hfp += te.t.hborder;
+		te.t.hbp += te.t.hborder;
+		te.t.vfp += te.t.vborder;
+		te.t.vbp += te.t.vborder;
+		te.t.hborder = te.t.vborder = 0;
+		dtds.push_back(te);
+	}
+	if (dtds.empty()) {
+		fprintf(stderr, "%s: no DTDs found.\n", p.name.c_str());
+		return -1;
+	}
+	for (const auto &te : dtds)
+		clks.push_back(pixclk_range(*this, te.t, p.min_pixclk_khz, p.max_pixclk_khz));
+
+	bool ok = true;
+
+	if (dts_file) {
+		FILE *f = strcmp(dts_file, "-") ? fopen(dts_file, "w") : stdout;
+
+		if (!f) {
+			perror(dts_file);
+			return -1;
+		}
+		print_dts(f, p, dtds, clks);
+		if (f != stdout)
+			ok &= !fclose(f);
+		else if (c_file && !strcmp(c_file, "-"))
+			printf("\n");
+	}
+	if (c_file) {
+		FILE *f = strcmp(c_file, "-") ? fopen(c_file, "w") : stdout;
+
+		if (!f) {
+			perror(c_file);
+			return -1;
+		}
+		print_c(f, p, dtds, clks, dtds[0].t.hsize_mm, dtds[0].t.vsize_mm);
+		if (f != stdout)
+			ok &= !fclose(f);
+	}
+	return ok ? 0 : -1;
+}
@@ -1319,9 +1319,14 @@ void edid_state::parse_base_block(const unsigned char *x)
 
 	data_block = "Vendor & Product Identification";
 	printf("  %s:\n", data_block.c_str());
-	printf("    Manufacturer: %s\n    Model: %u\n",
-	       manufacturer_name(x + 0x08),
+	const char *manufacturer = manufacturer_name(x + 0x08);
+	const char *pnp_name = registry_pnp_name(manufacturer);
+
+	printf("    Manufacturer: %s%s%s%s\n    Model: %u\n", manufacturer,
+	       pnp_name ? " (" : "", pnp_name ? pnp_name : "", pnp_name ? ")" : "",
 	       (unsigned short)(x[0x0a] + (x[0x0b] << 8)));
+	for (const auto &quirk : registry_quirks(manufacturer, x[0x0a] + (x[0x0b] << 8)))
+		printf("    Known quirk: %s\n", quirk.c_str());
 	base.has_serial_number = x[0x0c] || x[0x0d] || x[0x0e] || x[0x0f];
 	if (base.has_serial_number) {
 		if (hide_serial_numbers)
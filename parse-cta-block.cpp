@@ -11,6 +11,7 @@
 #include <math.h>
 
 #include "edid-decode.h"
+#include "edid-trace.h"
 
 static const struct timings edid_cta_modes1[] = {
 	/* VIC 1 */
@@ -1908,7 +1909,7 @@ void edid_state::cta_displayid_type_10(const unsigned char *x, unsigned length)
 	x++;
 	length--;
 	for (unsigned i = 0; i < length / sz; i++)
-		parse_displayid_type_10_timing(x + i * sz, true);
+		parse_displayid_type_10_timing(x + i * sz, sz, true);
 }
 
 static void cta_hdmi_audio_block(const unsigned char *x, unsigned length)
@@ -1985,6 +1986,7 @@ void edid_state::cta_ext_block(const unsigned char *x, unsigned length,
 	bool reverse = false;
 	bool audio_block = false;
 
+	coverage("cta-ext-tag 0x%02x", x[0]);
 	switch (x[0]) {
 	case 0x00: data_block = "Video Capability Data Block"; break;
 	case 0x01: data_block.clear(); break;
@@ -2166,6 +2168,8 @@ void edid_state::cta_block(const unsigned char *x, bool duplicate)
 	bool reverse = false;
 	bool audio_block = false;
 
+	if ((x[0] & 0xe0) != 0xe0)
+		coverage("cta-tag 0x%02x", x[0] >> 5);
 	switch ((x[0] & 0xe0) >> 5) {
 	case 0x01:
 		data_block = "Audio Data Block";
@@ -2179,6 +2183,12 @@ void edid_state::cta_block(const unsigned char *x, bool duplicate)
 		cta_svd(x + 1, length, false);
 		break;
 	case 0x03:
+		if (length < 3) {
+			data_block = "Vendor-Specific Data Block";
+			printf("  %s:\n", data_block.c_str());
+			fail("Empty Data Block with length %u.\n", length);
+			return;
+		}
 		oui = (x[3] << 16) + (x[2] << 8) + x[1];
 		name = oui_name(oui);
 		if (!name) {
@@ -2245,6 +2255,12 @@ void edid_state::cta_block(const unsigned char *x, bool duplicate)
 			fail("Only one instance of this Data Block is allowed.\n");
 		break;
 	case 0x07:
+		if (!length) {
+			data_block = "Extended Tag Data Block";
+			printf("  %s:\n", data_block.c_str());
+			fail("Extended Tag Data Block has length 0, the Extended Tag Code is missing.\n");
+			break;
+		}
 		cta_ext_block(x + 1, length - 1, duplicate);
 		break;
 	default: {
@@ -2298,6 +2314,8 @@ void edid_state::preparse_cta_block(const unsigned char *x)
 			}
 			break;
 		case 0x07:
+			if (!(x[i] & 0x1f))
+				break;
 			if (x[i + 1] == 0x0d)
 				cta.has_vfpdb = true;
 			if (x[i + 1] == 0x13 && (x[i + 2] & 0x40)) {
@@ -2415,7 +2433,9 @@ void edid_state::parse_cta_block(const unsigned char *x)
 					tag |= x[i + 1];
 				bool duplicate = cta.found_tags.find(tag) != cta.found_tags.end();
 
+				EDID_TRACE(cta_db_start, block_nr, tag, x[i] & 0x1f);
 				cta_block(x + i, duplicate);
+				EDID_TRACE(cta_db_end, block_nr, tag, x[i] & 0x1f);
 				if (!duplicate)
 					cta.found_tags.insert(tag);
 			}
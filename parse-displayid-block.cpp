@@ -10,6 +10,7 @@
 #include <math.h>
 
 #include "edid-decode.h"
+#include "edid-trace.h"
 
 static const char *bpc444[] = {"6", "8", "10", "12", "14", "16", NULL, NULL};
 static const char *bpc4xx[] = {"8", "10", "12", "14", "16", NULL, NULL, NULL};
@@ -1366,7 +1367,8 @@ void edid_state::parse_displayid_ContainerID(const unsigned char *x)
 
 // tag 0x32
 
-void edid_state::parse_displayid_type_10_timing(const unsigned char *x, bool is_cta)
+void edid_state::parse_displayid_type_10_timing(const unsigned char *x, unsigned sz,
+						bool is_cta)
 {
 	struct timings t = {};
 	std::string s("aspect ");
@@ -1413,7 +1415,35 @@ void edid_state::parse_displayid_type_10_timing(const unsigned char *x, bool is_
 	if (x[0] & 0x80)
 		s += ", YCbCr 4:2:0";
 
-	edid_cvt_mode(1 + x[5], t);
+	unsigned rb_h_blank = 0, rb_v_blank = 0;
+	bool early_vsync = false;
+
+	if ((t.rb & ~RB_ALT) == RB_CVT_V3) {
+		rb_h_blank = (t.rb & RB_ALT) ? 160 : 80;
+		// Descriptors of 7 bytes or more can adjust the hblank and vblank
+		if (sz >= 7) {
+			unsigned delta = (x[6] >> 2) & 0x07;
+			unsigned add_vblank = x[6] >> 5;
+
+			if (rb_h_blank == 80 || delta <= 5)
+				rb_h_blank += 8 * delta;
+			else
+				rb_h_blank -= 8 * (delta - 5);
+			// In steps of 35 us on top of the 460 us minimum
+			if (add_vblank) {
+				rb_v_blank = 460 + 35 * add_vblank;
+				s += ", vblank " + std::to_string(rb_v_blank) + " us";
+			}
+		}
+		if (x[0] & 0x08) {
+			s += ", early vsync";
+			early_vsync = true;
+		}
+	}
+
+	// Descriptors of 7 bytes or more have a 10 bit refresh rate
+	edid_cvt_mode(1 + x[5] + (sz >= 7 ? (x[6] & 0x03) << 8 : 0), t,
+		      rb_h_blank, rb_v_blank, early_vsync);
 
 	print_timings("    ", &t, "CVT", s.c_str());
 	if (is_cta) {
@@ -1708,6 +1738,8 @@ void edid_state::parse_displayid_block(const unsigned char *x)
 		}
 
 		printf("  %s:\n", data_block.c_str());
+		coverage("displayid-tag 0x%02x", tag);
+		EDID_TRACE(displayid_db_start, block_nr, tag, len);
 
 		switch (tag) {
 		case 0x00: parse_displayid_product_id(x + offset); break;
@@ -1825,7 +1857,7 @@ void edid_state::parse_displayid_block(const unsigned char *x)
 
 			   check_displayid_datablock_revision(x[offset + 1], 0x10);
 			   for (i = 0; i < len / sz; i++)
-				   parse_displayid_type_10_timing(&x[offset + 3 + i * sz]);
+				   parse_displayid_type_10_timing(&x[offset + 3 + i * sz], sz);
 			   break;
 		}
 		case 0x81: parse_displayid_cta_data_block(x + offset); break;
@@ -1837,6 +1869,7 @@ void edid_state::parse_displayid_block(const unsigned char *x)
 			// fall-through
 		default: hex_block("    ", x + offset + 3, len); break;
 		}
+		EDID_TRACE(displayid_db_end, block_nr, tag, len);
 
 		if ((tag == 0x00 || tag == 0x20) &&
 		    (!dispid.is_base_block || !first_data_block))
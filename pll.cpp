@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Check which timings a PLL with constrained dividers can generate.
+ *
+ * The pixel clock is ref / M * N / P, where N can have a fractional part
+ * of frac bits, so the clock is k * ref / (M * P * 2^frac) for an integer
+ * k. For each valid (M, P) pair the range of k follows from the N range
+ * and the VCO limits, so the best clock of a pair is found by rounding
+ * instead of by trying every N. The pairs are kept in a table of arrays
+ * that is built once, and the error of all pairs is computed in a single
+ * pass over the table before the best pair is picked.
+ *
+ * For each timing the best clock and its error in ppm is shown. For
+ * timings that cannot be generated within the tolerance the CVT variants
+ * with the same resolution and refresh rate are tried, and the one the
+ * PLL generates most accurately is suggested.
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "edid-decode.h"
+
+// Limit the (M, P) table to 1M pairs
+#define MAX_PLL_PAIRS (1U << 20)
+
+struct pll_table {
+	// Per (M, P) pair: the clock of k = 1 in kHz and the valid k range
+	std::vector<double> step_khz, k_min, k_max;
+	std::vector<unsigned> m, p;
+	// Scratch space for the errors
+	std::vector<double> err;
+};
+
+struct pll_result {
+	double khz;
+	double ppm;
+	unsigned m, n, frac, p;
+};
+
+static bool build_table(pll_table &tbl, const pll_config &pll)
+{
+	double steps = 1U << pll.frac_bits;
+
+	for (unsigned m = pll.m_min; m <= pll.m_max; m++) {
+		double pfd = (double)pll.ref_khz / m;
+
+		if ((pll.pfd_min_khz && pfd < pll.pfd_min_khz) ||
+		    (pll.pfd_max_khz && pfd > pll.pfd_max_khz))
+			continue;
+
+		double k_min = max(pll.n_min * steps, ceil(pll.vco_min_khz * steps / pfd));
+		double k_max = min(pll.n_max * steps, floor(pll.vco_max_khz * steps / pfd));
+
+		if (k_min > k_max)
+			continue;
+		for (unsigned p = pll.p_min; p <= pll.p_max; p++) {
+			if (tbl.m.size() == MAX_PLL_PAIRS)
+				return false;
+			tbl.step_khz.push_back(pfd / (p * steps));
+			tbl.k_min.push_back(k_min);
+			tbl.k_max.push_back(k_max);
+			tbl.m.push_back(m);
+			tbl.p.push_back(p);
+		}
+	}
+	tbl.err.resize(tbl.m.size());
+	return true;
+}
+
+static pll_result pll_search(pll_table &tbl, const pll_config &pll, double khz)
+{
+	const double *step = tbl.step_khz.data();
+	const double *k_min = tbl.k_min.data();
+	const double *k_max = tbl.k_max.data();
+	double *err = tbl.err.data();
+	unsigned size = tbl.m.size();
+	unsigned best = 0;
+
+	for (unsigned i = 0; i < size; i++) {
+		double k = min(max(floor(khz / step[i] + 0.5), k_min[i]), k_max[i]);
+
+		err[i] = fabs(k * step[i] - khz);
+	}
+	// Ties go to the smallest M and then the smallest P
+	for (unsigned i = 1; i < size; i++)
+		if (err[i] < err[best])
+			best = i;
+
+	double k = min(max(floor(khz / step[best] + 0.5), k_min[best]), k_max[best]);
+	unsigned long long kk = k;
+	pll_result r;
+
+	r.khz = k * step[best];
+	r.ppm = (r.khz - khz) * 1e6 / khz;
+	r.m = tbl.m[best];
+	r.n = kk >> pll.frac_bits;
+	r.frac = kk & ((1ULL << pll.frac_bits) - 1);
+	r.p = tbl.p[best];
+	return r;
+}
+
+static std::string result2s(const pll_result &r, const pll_config &pll)
+{
+	char buf[128];
+	int len;
+
+	len = snprintf(buf, sizeof(buf), "PLL %.6f MHz, M=%u N=%u", r.khz / 1000.0, r.m, r.n);
+	if (r.frac)
+		len += snprintf(buf + len, sizeof(buf) - len, "+%u/%u", r.frac, 1U << pll.frac_bits);
+	snprintf(buf + len, sizeof(buf) - len, " P=%u, %+.1f ppm%s", r.p, r.ppm,
+		 fabs(r.ppm) <= pll.tolerance_ppm ? "" : ", out of tolerance");
+	return buf;
+}
+
+static bool same_timings(const timings &t1, const timings &t2)
+{
+	return t1.pixclk_khz == t2.pixclk_khz && t1.hact == t2.hact && t1.vact == t2.vact &&
+		t1.interlaced == t2.interlaced &&
+		t1.hfp + t1.hsync + t1.hbp == t2.hfp + t2.hsync + t2.hbp &&
+		t1.vfp + t1.vsync + t1.vbp == t2.vfp + t2.vsync + t2.vbp;
+}
+
+// The frame rate of the timings, which is what calc_cvt_mode() expects
+static double frame_rate(const timings &t)
+{
+	unsigned htotal = t.hact + t.hfp + t.hsync + t.hbp + 2 * t.hborder;
+	double vtotal = t.vact + t.vfp + t.vsync + t.vbp + 2 * t.vborder;
+
+	if (t.interlaced)
+		vtotal = t.vact + 2 * (t.vfp + t.vsync + t.vbp + 2 * t.vborder) + 1;
+	return htotal && vtotal ? t.pixclk_khz * 1000.0 / (htotal * vtotal) : 0;
+}
+
+/*
+ * Try the CVT variants at the nearest integer refresh rate and at the
+ * refresh rate of the timings. Returns false if the PLL cannot generate
+ * any of them within the tolerance.
+ */
+static bool suggest_cvt(edid_state &state, pll_table &tbl, const pll_config &pll,
+			const timings &t, timings &best_t, std::string &best_name,
+			pll_result &best_r)
+{
+	double fps = frame_rate(t);
+	bool found = false;
+	char buf[64];
+
+	if (fps <= 0)
+		return false;
+
+	auto consider = [&](const timings &c, const char *name) {
+		if (!c.pixclk_khz)
+			return;
+
+		pll_result r = pll_search(tbl, pll, c.pixclk_khz);
+
+		if (fabs(r.ppm) > pll.tolerance_ppm || (found && fabs(r.ppm) >= fabs(best_r.ppm)))
+			return;
+		found = true;
+		best_t = c;
+		best_name = name;
+		best_r = r;
+	};
+
+	for (double rate : { round(fps), fps }) {
+		const char *i = t.interlaced ? "i" : "";
+
+		snprintf(buf, sizeof(buf), "CVT %.3f Hz%s", rate, i);
+		consider(state.calc_cvt_mode(t.hact, t.vact, rate, RB_NONE, t.interlaced), buf);
+		snprintf(buf, sizeof(buf), "CVT RBv1 %.3f Hz%s", rate, i);
+		consider(state.calc_cvt_mode(t.hact, t.vact, rate, RB_CVT_V1, t.interlaced), buf);
+		if (t.interlaced)
+			continue;
+		for (unsigned alt = 0; alt <= 1; alt++) {
+			snprintf(buf, sizeof(buf), "CVT RBv2 %.3f Hz%s", rate,
+				 alt ? ", video-optimized" : "");
+			consider(state.calc_cvt_mode(t.hact, t.vact, rate, RB_CVT_V2,
+						     false, false, alt), buf);
+		}
+		for (unsigned hblank = 80; hblank <= 200; hblank += 8) {
+			snprintf(buf, sizeof(buf), "CVT RBv3 %.3f Hz, h-blank %u", rate, hblank);
+			consider(state.calc_cvt_mode(t.hact, t.vact, rate, RB_CVT_V3,
+						     false, false, false, hblank), buf);
+		}
+	}
+	return found;
+}
+
+int edid_state::pll_analysis(const pll_config &pll)
+{
+	pll_table tbl;
+	vec_timings_ext shown;
+
+	// Move them out, since print_timings() below would add to them
+	shown.swap(all_timings);
+	if (!build_table(tbl, pll)) {
+		fprintf(stderr, "Too many M and P divider combinations.\n");
+		return -1;
+	}
+	if (tbl.m.empty()) {
+		fprintf(stderr, "No M and P divider combination meets the VCO and PFD limits.\n");
+		return -1;
+	}
+
+	vec_timings_ext modes;
+
+	for (const auto &te : shown) {
+		bool dup = !te.t.pixclk_khz || !te.t.hact;
+
+		for (unsigned i = 0; i < modes.size() && !dup; i++)
+			dup = same_timings(modes[i].t, te.t);
+		if (!dup)
+			modes.push_back(te);
+	}
+	if (modes.empty()) {
+		printf("No timings found.\n");
+		return 0;
+	}
+
+	unsigned ok = 0, exact = 0, suggested = 0;
+
+	printf("PLL analysis (%zu M/P combinations):\n", tbl.m.size());
+	for (const auto &te : modes) {
+		pll_result r = pll_search(tbl, pll, te.t.pixclk_khz);
+
+		ok += fabs(r.ppm) <= pll.tolerance_ppm;
+		exact += !r.ppm;
+		print_timings("  ", &te.t, te.type.c_str(), result2s(r, pll).c_str(), false, false);
+		if (fabs(r.ppm) <= pll.tolerance_ppm)
+			continue;
+
+		timings cvt;
+		std::string name;
+
+		if (suggest_cvt(*this, tbl, pll, te.t, cvt, name, r)) {
+			suggested++;
+			print_timings("    Use ", &cvt, name.c_str(), result2s(r, pll).c_str(),
+				      false, false);
+		}
+	}
+	printf("%u of %zu timings within %u ppm, %u exact", ok, modes.size(),
+	       pll.tolerance_ppm, exact);
+	if (ok < modes.size())
+		printf(", CVT alternatives for %u of the %zu other timings",
+		       suggested, modes.size() - ok);
+	printf("\n");
+	return ok == modes.size() ? 0 : -1;
+}
@@ -0,0 +1,416 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Pool of pre-forked decode workers for untrusted EDIDs.
+ *
+ * Every worker is confined by a seccomp filter to reading requests,
+ * writing results, allocating memory and exiting, so a memory safety bug
+ * triggered by a malicious EDID cannot escape the worker. Requests and
+ * results are passed over pipes. A worker that crashes or exceeds the
+ * time limit is killed and replaced by a freshly forked worker.
+ *
+ * Request:  32 bit length in host byte order, followed by the EDID file
+ *           contents (any format edid-decode accepts)
+ * Response: the decoded text, a 0 byte and the exit status of the decode
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#endif
+
+#include "edid-decode.h"
+
+#ifdef __linux__
+
+#if defined(__x86_64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+#elif defined(__i386__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_I386
+#elif defined(__aarch64__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#elif defined(__arm__)
+#define SECCOMP_AUDIT_ARCH AUDIT_ARCH_ARM
+#endif
+
+#ifndef SECCOMP_RET_KILL_PROCESS
+#define SECCOMP_RET_KILL_PROCESS SECCOMP_RET_KILL
+#endif
+
+// The decode of a 256 block EDID is far smaller than this
+#define POOL_MAX_RESULT (16U << 20)
+
+#define ALLOW_SYSCALL(nr) \
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (nr), 0, 1), \
+	BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)
+
+static bool sandbox(void)
+{
+#ifdef SECCOMP_AUDIT_ARCH
+	struct sock_filter filter[] = {
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0),
+		BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+		BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+		ALLOW_SYSCALL(__NR_read),
+		ALLOW_SYSCALL(__NR_write),
+		ALLOW_SYSCALL(__NR_exit),
+		ALLOW_SYSCALL(__NR_exit_group),
+		ALLOW_SYSCALL(__NR_rt_sigreturn),
+		// The C++ runtime allocates memory while decoding
+		ALLOW_SYSCALL(__NR_brk),
+#ifdef __NR_mmap
+		ALLOW_SYSCALL(__NR_mmap),
+#endif
+#ifdef __NR_mmap2
+		ALLOW_SYSCALL(__NR_mmap2),
+#endif
+		ALLOW_SYSCALL(__NR_munmap),
+		ALLOW_SYSCALL(__NR_mremap),
+		ALLOW_SYSCALL(__NR_madvise),
+		BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+	};
+	struct sock_fprog prog = {
+		(unsigned short)(sizeof(filter) / sizeof(filter[0])), filter
+	};
+
+	return !prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) &&
+		!prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog);
+#else
+	return false;
+#endif
+}
+
+static bool read_full(int fd, void *buf, size_t len)
+{
+	char *p = (char *)buf;
+
+	while (len) {
+		ssize_t n = read(fd, p, len);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool write_full(int fd, const void *buf, size_t len)
+{
+	const char *p = (const char *)buf;
+
+	while (len) {
+		ssize_t n = write(fd, p, len);
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+static void worker_main(pool_decode_fn decode)
+{
+	static char stdout_buf[65536];
+	uint32_t len;
+
+	// Do everything that needs other system calls before the sandbox
+	setvbuf(stdout, stdout_buf, _IOFBF, sizeof(stdout_buf));
+	// With TZ set localtime() loads the time zone only once
+	setenv("TZ", ":/etc/localtime", 0);
+	time_t now = time(NULL);
+	localtime(&now);
+
+	if (!sandbox()) {
+		fprintf(stderr, "Could not sandbox the decode worker.\n");
+		_exit(1);
+	}
+
+	while (read_full(0, &len, sizeof(len))) {
+		std::vector<char> request(len);
+
+		if (len && !read_full(0, &request[0], len))
+			break;
+		unsigned char status = decode(request) ? 1 : 0;
+
+		fflush(stdout);
+		write_full(1, "", 1);
+		write_full(1, &status, 1);
+	}
+	_exit(0);
+}
+
+struct worker {
+	pid_t pid;
+	int req_fd;
+	int resp_fd;
+	int request;		// -1 if idle
+	std::string result;
+	double deadline;
+	unsigned registry_version;	// of the registry the worker was forked with
+};
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool spawn_worker(worker &w, std::vector<worker> &workers, pool_decode_fn decode)
+{
+	int req[2], resp[2];
+
+	if (pipe(req))
+		return false;
+	if (pipe(resp)) {
+		close(req[0]);
+		close(req[1]);
+		return false;
+	}
+	fflush(stdout);
+	fflush(stderr);
+	w.registry_version = registry_version();
+	w.pid = fork();
+	if (w.pid == 0) {
+		for (auto &other : workers) {
+			if (other.pid <= 0)
+				continue;
+			close(other.req_fd);
+			close(other.resp_fd);
+		}
+		dup2(req[0], 0);
+		dup2(resp[1], 1);
+		close(req[0]);
+		close(req[1]);
+		close(resp[0]);
+		close(resp[1]);
+		worker_main(decode);
+	}
+	close(req[0]);
+	close(resp[1]);
+	if (w.pid < 0) {
+		close(req[1]);
+		close(resp[0]);
+		return false;
+	}
+	w.req_fd = req[1];
+	w.resp_fd = resp[0];
+	w.request = -1;
+	w.result.clear();
+	return true;
+}
+
+static void kill_worker(worker &w)
+{
+	kill(w.pid, SIGKILL);
+	waitpid(w.pid, NULL, 0);
+	close(w.req_fd);
+	close(w.resp_fd);
+	w.pid = 0;
+}
+
+static std::string crash_reason(worker &w)
+{
+	int status = 0;
+	char buf[80];
+
+	waitpid(w.pid, &status, 0);
+	close(w.req_fd);
+	close(w.resp_fd);
+	w.pid = 0;
+	if (WIFSIGNALED(status) && WTERMSIG(status) == SIGSYS)
+		return "Decode worker was killed: forbidden system call.\n";
+	if (WIFSIGNALED(status))
+		snprintf(buf, sizeof(buf), "Decode worker crashed: signal %d.\n", WTERMSIG(status));
+	else
+		snprintf(buf, sizeof(buf), "Decode worker exited with status %d.\n", WEXITSTATUS(status));
+	return buf;
+}
+
+static bool read_request(const std::string &file, std::vector<char> &data)
+{
+	FILE *f = file == "-" ? stdin : fopen(file.c_str(), "rb");
+	char buf[4096];
+	size_t n;
+
+	if (!f)
+		return false;
+	while ((n = fread(buf, 1, sizeof(buf), f)))
+		data.insert(data.end(), buf, buf + n);
+	bool ok = !ferror(f);
+	if (f != stdin)
+		fclose(f);
+	return ok;
+}
+
+int worker_pool(const std::vector<std::string> &files, unsigned num_workers,
+		unsigned timeout_ms, pool_decode_fn decode)
+{
+	std::vector<worker> workers(num_workers);
+	std::vector<std::string> results(files.size());
+	std::vector<bool> done(files.size());
+	unsigned next = 0, printed = 0;
+	int ret = 0;
+
+	signal(SIGPIPE, SIG_IGN);
+	for (auto &w : workers) {
+		if (!spawn_worker(w, workers, decode)) {
+			perror("fork");
+			return -1;
+		}
+	}
+
+	while (printed < files.size()) {
+		for (auto &w : workers) {
+			// A worker only sees the registry it was forked with
+			if (w.pid > 0 && w.request < 0 &&
+			    w.registry_version != registry_version())
+				kill_worker(w);
+			if (w.pid <= 0 && !spawn_worker(w, workers, decode)) {
+				perror("fork");
+				return -1;
+			}
+			if (w.request >= 0 || next == files.size())
+				continue;
+
+			std::vector<char> data;
+			uint32_t len;
+
+			if (!read_request(files[next], data)) {
+				results[next] = files[next] + ": " + strerror(errno) + "\n";
+				done[next++] = true;
+				ret = -1;
+				continue;
+			}
+			len = data.size();
+			w.request = next++;
+			w.deadline = now_ms() + timeout_ms;
+			w.result.clear();
+			if (!write_full(w.req_fd, &len, sizeof(len)) ||
+			    !write_full(w.req_fd, data.data(), len)) {
+				results[w.request] = crash_reason(w);
+				done[w.request] = true;
+				ret = -1;
+			}
+		}
+
+		std::vector<pollfd> fds;
+		std::vector<worker *> busy;
+		double timeout = -1;
+
+		for (auto &w : workers) {
+			if (w.pid <= 0 || w.request < 0)
+				continue;
+			fds.push_back({ w.resp_fd, POLLIN, 0 });
+			busy.push_back(&w);
+			double left = w.deadline - now_ms();
+			if (timeout < 0 || left < timeout)
+				timeout = left > 0 ? left : 0;
+		}
+		if (!busy.empty() && poll(fds.data(), fds.size(), (int)ceil(timeout)) < 0 &&
+		    errno != EINTR) {
+			perror("poll");
+			return -1;
+		}
+
+		for (unsigned i = 0; i < busy.size(); i++) {
+			worker &w = *busy[i];
+			unsigned req = w.request;
+			bool finished = false;
+
+			if (fds[i].revents) {
+				char buf[4096];
+				ssize_t n = read(w.resp_fd, buf, sizeof(buf));
+
+				if (n > 0) {
+					w.result.append(buf, n);
+
+					size_t len = w.result.size();
+
+					// Wait for the 0 byte and the exit status
+					if (len >= 2 && !w.result[len - 2]) {
+						if (w.result[len - 1])
+							ret = -1;
+						w.result.resize(len - 2);
+						finished = true;
+					}
+				} else if (n == 0 || errno != EINTR) {
+					w.result = crash_reason(w);
+					ret = -1;
+					finished = true;
+				}
+			}
+			// Also stop a worker that keeps writing
+			if (!finished && (now_ms() >= w.deadline ||
+					  w.result.size() > POOL_MAX_RESULT)) {
+				char s[80];
+
+				if (w.result.size() > POOL_MAX_RESULT)
+					snprintf(s, sizeof(s),
+						 "Decode worker exceeded the output limit of %u bytes.\n",
+						 POOL_MAX_RESULT);
+				else
+					snprintf(s, sizeof(s),
+						 "Decode worker exceeded the time limit of %u ms.\n",
+						 timeout_ms);
+				kill_worker(w);
+				w.result = s;
+				ret = -1;
+				finished = true;
+			}
+			if (!finished)
+				continue;
+			results[req].swap(w.result);
+			done[req] = true;
+			w.request = -1;
+		}
+
+		for (; printed < files.size() && done[printed]; printed++) {
+			printf("==> %s <==\n%s", files[printed].c_str(), results[printed].c_str());
+			results[printed].clear();
+		}
+		fflush(stdout);
+	}
+
+	for (auto &w : workers) {
+		if (w.pid <= 0)
+			continue;
+		close(w.req_fd);
+		close(w.resp_fd);
+		waitpid(w.pid, NULL, 0);
+	}
+	return ret;
+}
+
+#else
+
+int worker_pool(const std::vector<std::string> &files, unsigned num_workers,
+		unsigned timeout_ms, pool_decode_fn decode)
+{
+	fprintf(stderr, "The decode worker pool is only supported on Linux.\n");
+	return -1;
+}
+
+#endif
@@ -0,0 +1,344 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Registry of OUI and PNP ID names, display quirks and diagnostic rules
+ * loaded from a file.
+ *
+ * The registry is an immutable snapshot that is published through an
+ * atomic pointer. Decoders pin the current snapshot for the duration of
+ * a decode (registry_pin), so a reload never changes the names halfway
+ * through an EDID and lookups never take a lock. Replaced snapshots are
+ * freed once no reader that could still see them is active (epoch-based
+ * reclamation).
+ *
+ * The file contains one entry per line, '#' starts a comment:
+ *
+ *   oui 00-0C-03 HDMI
+ *   pnp GSM LG Electronics
+ *   quirk GSM:c0a1 Advertises HDR modes it cannot display
+ *   rule warn fail Missing Display Range Limits Descriptor.
+ *
+ * A quirk is shown with the model it belongs to. A rule ignores a
+ * diagnostic (ignore), or reports it as a warning (warn) or a failure
+ * (fail); diagnostics are named as for --coverage. Lines with other
+ * keywords are ignored.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <ctype.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "edid-decode.h"
+#include "edid-trace.h"
+
+struct registry {
+	unsigned version;
+	std::map<unsigned, std::string> ouis;
+	std::map<std::string, std::string> pnps;
+	// Keyed by PNP ID and product code, e.g. "GSM:c0a1"
+	std::multimap<std::string, std::string> quirks;
+	std::map<std::string, registry_action> rules;
+};
+
+#define REGISTRY_MAX_READERS 64
+
+static std::atomic<const registry *> cur_registry;
+static std::atomic<unsigned long> registry_epoch(1);
+// 0 if the reader is idle, otherwise the epoch at which it pinned
+static std::atomic<unsigned long> reader_epochs[REGISTRY_MAX_READERS];
+static std::atomic<bool> reader_used[REGISTRY_MAX_READERS];
+
+// The reader slot of a thread, given back when the thread exits
+struct reader_slot_owner {
+	int slot = -1;
+
+	~reader_slot_owner()
+	{
+		if (slot < 0)
+			return;
+		reader_epochs[slot].store(0);
+		reader_used[slot].store(false);
+	}
+};
+
+static thread_local reader_slot_owner reader_slot;
+static thread_local unsigned pin_depth;
+static thread_local const registry *pinned;
+
+// Writer state, protected by writer_lock
+static std::mutex writer_lock;
+static std::vector<std::pair<unsigned long, const registry *> > retired;
+static std::string registry_file;
+static time_t registry_mtime;
+static unsigned registry_versions;
+
+static volatile sig_atomic_t reload_requested;
+
+static int reader_slot_acquire()
+{
+	for (unsigned i = 0; i < REGISTRY_MAX_READERS; i++) {
+		bool used = false;
+
+		if (reader_used[i].compare_exchange_strong(used, true))
+			return i;
+	}
+	return -1;
+}
+
+registry_pin::registry_pin()
+{
+	static std::atomic<bool> warned;
+
+	if (pin_depth++)
+		return;
+	if (reader_slot.slot < 0)
+		reader_slot.slot = reader_slot_acquire();
+	if (reader_slot.slot < 0) {
+		// Without a slot the snapshot could be freed, so decode without names
+		if (!warned.exchange(true))
+			fprintf(stderr, "Too many registry readers, registry names are not used.\n");
+		return;
+	}
+	reader_epochs[reader_slot.slot].store(registry_epoch.load());
+	pinned = cur_registry.load();
+}
+
+registry_pin::~registry_pin()
+{
+	if (--pin_depth)
+		return;
+	pinned = NULL;
+	if (reader_slot.slot >= 0)
+		reader_epochs[reader_slot.slot].store(0);
+}
+
+const char *registry_oui_name(unsigned oui)
+{
+	if (!pinned)
+		return NULL;
+
+	std::map<unsigned, std::string>::const_iterator iter = pinned->ouis.find(oui);
+	bool found = iter != pinned->ouis.end();
+
+	EDID_TRACE(registry_lookup, 0, found);
+	return found ? iter->second.c_str() : NULL;
+}
+
+const char *registry_pnp_name(const char *pnp)
+{
+	if (!pinned)
+		return NULL;
+
+	std::map<std::string, std::string>::const_iterator iter = pinned->pnps.find(pnp);
+	bool found = iter != pinned->pnps.end();
+
+	EDID_TRACE(registry_lookup, 1, found);
+	return found ? iter->second.c_str() : NULL;
+}
+
+std::vector<std::string> registry_quirks(const char *pnp, unsigned product)
+{
+	std::vector<std::string> quirks;
+	char key[16];
+
+	if (!pinned || pinned->quirks.empty())
+		return quirks;
+	snprintf(key, sizeof(key), "%s:%04x", pnp, product);
+
+	auto range = pinned->quirks.equal_range(key);
+
+	for (auto iter = range.first; iter != range.second; ++iter)
+		quirks.push_back(iter->second);
+	return quirks;
+}
+
+registry_action registry_rule(bool is_warn, const char *fmt)
+{
+	if (!pinned || pinned->rules.empty())
+		return REGISTRY_KEEP;
+
+	std::map<std::string, registry_action>::const_iterator iter =
+		pinned->rules.find(diag_name(is_warn, fmt));
+
+	return iter == pinned->rules.end() ? REGISTRY_KEEP : iter->second;
+}
+
+unsigned registry_version()
+{
+	registry_pin pin;
+
+	return pinned ? pinned->version : 0;
+}
+
+// Free all retired snapshots that no active reader can still see
+static void registry_reclaim()
+{
+	unsigned long min_epoch = ~0UL;
+
+	for (unsigned i = 0; i < REGISTRY_MAX_READERS; i++) {
+		unsigned long e = reader_epochs[i].load();
+
+		if (e && e < min_epoch)
+			min_epoch = e;
+	}
+
+	std::vector<std::pair<unsigned long, const registry *> >::iterator iter;
+
+	for (iter = retired.begin(); iter != retired.end(); ) {
+		if (iter->first < min_epoch) {
+			delete iter->second;
+			iter = retired.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+}
+
+static registry *registry_parse(const char *file)
+{
+	FILE *f = fopen(file, "r");
+	char line[256];
+	unsigned nr = 0;
+
+	if (!f) {
+		perror(file);
+		return NULL;
+	}
+
+	registry *r = new registry;
+
+	while (fgets(line, sizeof(line), f)) {
+		char *p = strchr(line, '#');
+		char key[8], id[16];
+		int n;
+
+		nr++;
+		if (p)
+			*p = 0;
+		p = line + strlen(line);
+		while (p > line && isspace(p[-1]))
+			*--p = 0;
+		if (sscanf(line, " %7s %15s %n", key, id, &n) < 2)
+			continue;
+
+		if (!strcmp(key, "oui")) {
+			unsigned b1, b2, b3;
+
+			if (sscanf(id, "%2x-%2x-%2x", &b1, &b2, &b3) != 3 || !line[n]) {
+				fprintf(stderr, "%s:%u: invalid OUI entry.\n", file, nr);
+				continue;
+			}
+			r->ouis[(b1 << 16) | (b2 << 8) | b3] = line + n;
+		} else if (!strcmp(key, "pnp")) {
+			if (strlen(id) != 3 || !line[n]) {
+				fprintf(stderr, "%s:%u: invalid PNP ID entry.\n", file, nr);
+				continue;
+			}
+			r->pnps[id] = line + n;
+		} else if (!strcmp(key, "quirk")) {
+			char pnp[4], end;
+			unsigned product;
+
+			if (sscanf(id, "%3[A-Z@]:%4x%c", pnp, &product, &end) != 2 ||
+			    strlen(pnp) != 3 || !line[n]) {
+				fprintf(stderr, "%s:%u: invalid quirk entry.\n", file, nr);
+				continue;
+			}
+			snprintf(id, sizeof(id), "%s:%04x", pnp, product);
+			r->quirks.insert(std::make_pair(std::string(id), std::string(line + n)));
+		} else if (!strcmp(key, "rule")) {
+			registry_action action;
+
+			if (!strcmp(id, "ignore"))
+				action = REGISTRY_IGNORE;
+			else if (!strcmp(id, "warn"))
+				action = REGISTRY_WARN;
+			else if (!strcmp(id, "fail"))
+				action = REGISTRY_FAIL;
+			else
+				action = REGISTRY_KEEP;
+			if (action == REGISTRY_KEEP ||
+			    (strncmp(line + n, "warn ", 5) && strncmp(line + n, "fail ", 5))) {
+				fprintf(stderr, "%s:%u: invalid rule entry.\n", file, nr);
+				continue;
+			}
+			r->rules[line + n] = action;
+		}
+	}
+	fclose(f);
+	return r;
+}
+
+bool registry_load(const char *file)
+{
+	registry *r = registry_parse(file);
+	struct stat st;
+
+	if (!r)
+		return false;
+
+	std::lock_guard<std::mutex> lock(writer_lock);
+
+	registry_file = file;
+	if (!stat(file, &st))
+		registry_mtime = st.st_mtime;
+	r->version = ++registry_versions;
+
+	const registry *old = cur_registry.exchange(r);
+
+	if (old)
+		retired.push_back(std::make_pair(registry_epoch.fetch_add(1), old));
+	registry_reclaim();
+	return true;
+}
+
+static void registry_sighup(int sig)
+{
+	reload_requested = 1;
+}
+
+static void registry_watch()
+{
+	for (;;) {
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+
+		std::string file;
+		struct stat st;
+		bool reload = reload_requested;
+
+		{
+			std::lock_guard<std::mutex> lock(writer_lock);
+
+			file = registry_file;
+			if (!stat(file.c_str(), &st) && st.st_mtime != registry_mtime) {
+				registry_mtime = st.st_mtime;
+				reload = true;
+			}
+			registry_reclaim();
+		}
+		if (reload) {
+			reload_requested = 0;
+			registry_load(file.c_str());
+		}
+	}
+}
+
+/*
+ * Reload the registry in the background on SIGHUP or when the
+ * registry file changes. For use by long-running modes.
+ */
+void registry_watch_start()
+{
+	if (registry_file.empty())
+		return;
+#ifdef SIGHUP
+	signal(SIGHUP, registry_sighup);
+#endif
+	std::thread(registry_watch).detach();
+}
@@ -0,0 +1,396 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Synthesize the EDID that an HDMI repeater advertises upstream from
+ * the EDID of its downstream sink.
+ *
+ * This works directly on the CTA-861 Data Block Collection: no text
+ * decode is done, so it is cheap enough to run on every hotplug.
+ */
+
+#include <algorithm>
+#include <stdio.h>
+
+#include "edid-view.h"
+
+typedef std::vector<unsigned char> data_block;
+
+static unsigned max_pixclk_khz(const repeater_caps &caps)
+{
+	unsigned max_khz = caps.max_tmds_mhz ? caps.max_tmds_mhz * 1000 : ~0U;
+	// Max_FRL_Rate values above 6 are reserved
+	unsigned frl = min(caps.max_frl, 6U);
+
+	// 16b/18b encoding and 24 bits per pixel for 8 bpc RGB
+	if (frl && caps.max_tmds_mhz)
+		max_khz = max(max_khz, frl_gbps(frl) * 1000000 / 18 * 16 / 24);
+	return max_khz;
+}
+
+static bool svd_ok(unsigned char svd, unsigned max_khz, bool ycbcr420)
+{
+	const timings *t = find_vic_id(svd_vic(svd));
+
+	if (!t)
+		return true;
+	return t->pixclk_khz / (ycbcr420 ? 2 : 1) <= max_khz;
+}
+
+static void clip_audio(data_block &db, unsigned channels)
+{
+	for (unsigned i = 1; i + 2 < db.size(); i += 3)
+		if ((db[i] & 0x07) + 1U > channels)
+			db[i] = (db[i] & ~0x07) | (channels - 1);
+}
+
+static void clip_hf_scdb(data_block &db, const repeater_caps &caps)
+{
+	// The payload starts at offset 4 for both the HF-VSDB and HF-SCDB
+	if (db.size() < 8)
+		return;
+
+	unsigned char *p = &db[4];
+
+	if (caps.max_tmds_mhz && p[1] * 5U > caps.max_tmds_mhz)
+		p[1] = caps.max_tmds_mhz > 340 ? caps.max_tmds_mhz / 5 : 0;
+	if ((p[3] >> 4) > caps.max_frl)
+		p[3] = (p[3] & 0x0f) | (caps.max_frl << 4);
+	if (caps.max_bpc < 16)
+		p[3] &= ~0x04;
+	if (caps.max_bpc < 12)
+		p[3] &= ~0x02;
+	if (caps.max_bpc < 10)
+		p[3] &= ~0x01;
+}
+
+static unsigned short phys_addr_add_hop(unsigned short pa, unsigned port)
+{
+	if (pa == 0xffff)
+		return pa;
+	for (int shift = 12; shift >= 0; shift -= 4)
+		if (!((pa >> shift) & 0xf))
+			return pa | (port << shift);
+	// Too deep, this repeater has no valid physical address
+	return 0xffff;
+}
+
+static void clip_hdmi_vsdb(data_block &db, const repeater_caps &caps,
+			   unsigned max_khz, bool svds_dropped)
+{
+	if (db.size() < 6)
+		return;
+
+	unsigned short pa = phys_addr_add_hop((db[4] << 8) | db[5], caps.port);
+
+	db[4] = pa >> 8;
+	db[5] = pa & 0xff;
+	if (db.size() < 7)
+		return;
+
+	if (caps.max_bpc < 16)
+		db[6] &= ~0x40;
+	if (caps.max_bpc < 12)
+		db[6] &= ~0x20;
+	if (caps.max_bpc < 10)
+		db[6] &= ~0x10;
+	if (!(db[6] & 0x70))
+		db[6] &= ~0x08;
+	if (db.size() < 8)
+		return;
+
+	if (caps.max_tmds_mhz && db[7] * 5U > caps.max_tmds_mhz)
+		db[7] = caps.max_tmds_mhz / 5;
+	if (db.size() < 9 || !(db[8] & 0x20))
+		return;
+
+	unsigned b = 9;
+
+	if (db[8] & 0x80)
+		b += (db[8] & 0x40) ? 4 : 2;
+	if (b + 1 >= db.size())
+		return;
+
+	unsigned len_vic = db[b + 1] >> 5;
+	unsigned len_3d = db[b + 1] & 0x1f;
+	data_block vics;
+
+	for (unsigned i = 0; i < len_vic && b + 2 + i < db.size(); i++) {
+		const timings *t = find_hdmi_vic_id(db[b + 2 + i]);
+
+		if (!t || t->pixclk_khz <= max_khz)
+			vics.push_back(db[b + 2 + i]);
+	}
+
+	data_block out(db.begin(), db.begin() + b + 2);
+
+	out.insert(out.end(), vics.begin(), vics.end());
+	if (svds_dropped) {
+		// The 3D information refers to SVD indices, drop it
+		out[b] &= ~0xe0;
+		len_3d = 0;
+	} else if (b + 2 + len_vic + len_3d <= db.size()) {
+		out.insert(out.end(), db.begin() + b + 2 + len_vic,
+			   db.begin() + b + 2 + len_vic + len_3d);
+	} else {
+		len_3d = 0;
+	}
+	out[b + 1] = (vics.size() << 5) | len_3d;
+	db = out;
+}
+
+/*
+ * SVRs 129-144 refer to the DTDs of the whole EDID in order, starting
+ * with those of the base block. Returns for each DTD if it is kept.
+ */
+static std::vector<bool> dtds_kept(const unsigned char *edid, unsigned num_blocks,
+				   unsigned max_khz)
+{
+	base_block_view base(byte_view(edid, EDID_PAGE_SIZE));
+	std::vector<bool> kept;
+
+	for (unsigned i = 0; i < 4; i++)
+		if (base.descriptor(i).is_dtd())
+			kept.push_back(true);
+	for (unsigned i = 1; i < num_blocks; i++) {
+		const unsigned char *x = edid + i * EDID_PAGE_SIZE;
+		cta_view cta(x);
+
+		if (x[0] != 0x02 || x[2] < 4 || x[2] > 127)
+			continue;
+		for (auto dtd : cta.dtds())
+			kept.push_back(cta.revision() < 3 || dtd.pixclk_khz() <= max_khz);
+	}
+	return kept;
+}
+
+static bool repeater_cta_block(unsigned char *x, const repeater_caps &caps,
+			       const std::vector<bool> &dtd_kept)
+{
+	cta_view cta(x);
+	unsigned max_khz = max_pixclk_khz(caps);
+	std::vector<data_block> dbs;
+	std::vector<bool> svd_kept;
+	std::vector<unsigned char> dropped_vics;
+	unsigned end = 4;
+
+	// Without data blocks there is nothing to filter
+	if (cta.revision() < 3 || !x[2])
+		return true;
+	if (x[2] < 4 || x[2] > 127)
+		return false;
+
+	for (auto db : cta.data_blocks()) {
+		dbs.push_back(data_block(db.x.p, db.x.p + db.x.size()));
+		end += db.x.size();
+	}
+	// The last data block runs past the DTDs
+	if (end != cta.dtd_offset())
+		return false;
+
+	// First pass: the SVDs, since other blocks refer to them
+	for (auto &db : dbs) {
+		if ((db[0] >> 5) != 0x02)
+			continue;
+
+		data_block out(1, db[0]);
+
+		for (unsigned i = 1; i < db.size(); i++) {
+			bool ok = svd_ok(db[i], max_khz, false);
+
+			svd_kept.push_back(ok);
+			if (ok)
+				out.push_back(db[i]);
+			else
+				dropped_vics.push_back(svd_vic(db[i]));
+		}
+		db = out;
+	}
+
+	bool svds_dropped = !dropped_vics.empty();
+	std::vector<data_block> out_dbs;
+
+	for (auto &db : dbs) {
+		data_block_view v(byte_view(&db[0], db.size()));
+		unsigned tag = v.tag();
+		unsigned ext = v.ext_tag();
+		unsigned oui = v.oui();
+
+		switch (tag) {
+		case 0x01:
+			if (!caps.audio_channels)
+				continue;
+			clip_audio(db, caps.audio_channels);
+			break;
+		case 0x02:
+			if (db.size() == 1)
+				continue;
+			break;
+		case 0x03:
+			if (oui == 0x000c03)
+				clip_hdmi_vsdb(db, caps, max_khz, svds_dropped);
+			else if (oui == 0xc45dd8)
+				clip_hf_scdb(db, caps);
+			break;
+		case 0x04:
+			if (!caps.audio_channels)
+				continue;
+			break;
+		}
+		if (tag != 0x07 || ext == ~0U) {
+			out_dbs.push_back(db);
+			continue;
+		}
+
+		switch (ext) {
+		case 0x01:
+			// Dolby Vision and HDR10+ VSVDBs
+			if (!caps.hdr && (oui == 0x00d046 || oui == 0x90848b))
+				continue;
+			break;
+		case 0x06:
+		case 0x07:
+			if (!caps.hdr)
+				continue;
+			break;
+		case 0x0d: {
+			// VFPDB: drop the SVRs of dropped VICs and DTDs
+			data_block out(db.begin(), db.begin() + 2);
+
+			for (unsigned i = 2; i < db.size(); i++) {
+				unsigned char svr = db[i];
+
+				if (svr >= 129 && svr <= 144) {
+					unsigned idx = min(svr - 129U, (unsigned)dtd_kept.size());
+
+					if (idx < dtd_kept.size() && !dtd_kept[idx])
+						continue;
+					// Skip the dropped DTDs before this one
+					svr -= std::count(dtd_kept.begin(),
+							  dtd_kept.begin() + idx, false);
+				} else if (std::find(dropped_vics.begin(), dropped_vics.end(),
+						     svr) != dropped_vics.end()) {
+					continue;
+				}
+				out.push_back(svr);
+			}
+			if (out.size() == 2)
+				continue;
+			db = out;
+			break;
+		}
+		case 0x0e: {
+			if (!caps.ycbcr420)
+				continue;
+
+			data_block out(db.begin(), db.begin() + 2);
+
+			for (unsigned i = 2; i < db.size(); i++)
+				if (svd_ok(db[i], max_khz, true))
+					out.push_back(db[i]);
+			if (out.size() == 2)
+				continue;
+			db = out;
+			break;
+		}
+		case 0x0f: {
+			if (!caps.ycbcr420)
+				continue;
+			// An empty map means all SVDs, otherwise remap the bits
+			if (db.size() == 2 || !svds_dropped)
+				break;
+
+			cmdb_view map(byte_view(db.data(), db.size()));
+			data_block out(db.begin(), db.begin() + 2);
+			unsigned idx = 0;
+
+			for (unsigned i = 0; i < svd_kept.size(); i++) {
+				if (!svd_kept[i])
+					continue;
+				if (idx % 8 == 0)
+					out.push_back(0);
+				if (map.ycbcr420(i))
+					out.back() |= 1 << (idx % 8);
+				idx++;
+			}
+			while (out.size() > 2 && !out.back())
+				out.pop_back();
+			if (out.size() == 2)
+				continue;
+			db = out;
+			break;
+		}
+		case 0x11:
+		case 0x12:
+		case 0x13:
+		case 0x14:
+			if (!caps.audio_channels)
+				continue;
+			break;
+		case 0x79:
+			clip_hf_scdb(db, caps);
+			break;
+		}
+		out_dbs.push_back(db);
+	}
+
+	std::vector<const unsigned char *> dtds;
+
+	for (auto dtd : cta.dtds())
+		if (dtd.pixclk_khz() <= max_khz)
+			dtds.push_back(dtd.x.p);
+
+	unsigned char out[EDID_PAGE_SIZE] = {};
+
+	memcpy(out, x, 4);
+	unsigned o = 4;
+
+	for (auto &db : out_dbs) {
+		db[0] = (db[0] & 0xe0) | (db.size() - 1);
+		memcpy(out + o, &db[0], db.size());
+		o += db.size();
+	}
+	out[2] = o;
+	for (auto dtd : dtds) {
+		memcpy(out + o, dtd, 18);
+		o += 18;
+	}
+	if (!caps.audio_channels)
+		out[3] &= ~0x40;
+	memcpy(x, out, EDID_PAGE_SIZE - 1);
+	return true;
+}
+
+static void fix_checksum(unsigned char *x)
+{
+	unsigned char sum = 0;
+
+	for (unsigned i = 0; i < EDID_PAGE_SIZE - 1; i++)
+		sum += x[i];
+	x[EDID_PAGE_SIZE - 1] = -sum;
+}
+
+/*
+ * Rewrite the EDID in place into the EDID that a repeater with the
+ * given capabilities advertises upstream. Returns false if a CTA-861
+ * block is corrupt.
+ */
+bool repeater_edid(unsigned char *edid, unsigned num_blocks, const repeater_caps &req_caps)
+{
+	repeater_caps caps = req_caps;
+	bool ok = true;
+
+	// FRL 1 requires a max TMDS rate of 300 MHz, FRL >= 2 requires 600 MHz
+	if (caps.max_tmds_mhz && caps.max_tmds_mhz < 600 && caps.max_frl > 1)
+		caps.max_frl = caps.max_tmds_mhz >= 300 ? 1 : 0;
+
+	std::vector<bool> dtd_kept = dtds_kept(edid, num_blocks, max_pixclk_khz(caps));
+
+	for (unsigned i = 1; i < num_blocks; i++) {
+		unsigned char *x = edid + i * EDID_PAGE_SIZE;
+
+		if (x[0] == 0x02 && !repeater_cta_block(x, caps, dtd_kept))
+			ok = false;
+	}
+	for (unsigned i = 0; i < num_blocks; i++)
+		fix_checksum(edid + i * EDID_PAGE_SIZE);
+	return ok;
+}
@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Semantic hash of an EDID.
+ *
+ * EDIDs that differ in their bytes can still describe the same display:
+ * the CTA-861 Data Blocks can be in any order or split over several CTA
+ * Extension Blocks, DTDs can be in the base block or in a CTA Extension
+ * Block, the padding can differ and the serial numbers, manufacture date
+ * and checksums differ between two units of the same model. The semantic
+ * hash is computed over a canonical form of the EDID that removes these
+ * differences:
+ *
+ * - the serial numbers, the manufacture date, the Container ID and the
+ *   DisplayID serial number fields are masked. The manufacturer and
+ *   product code are kept, since quirks are matched on them;
+ * - the DTDs of all blocks and the Standard Timings are sorted and
+ *   duplicates removed, only the preferred timing keeps its place;
+ * - the Data Blocks of all CTA-861 Extension Blocks and of all DisplayID
+ *   Extension Blocks are sorted and duplicates removed;
+ * - but the Video Data Blocks and the DTDs keep their order if other
+ *   blocks refer to the SVDs or DTDs by index: the YCbCr 4:2:0 Capability
+ *   Map, the 3D_MASK and 2D_VIC_order fields of the HDMI VSDB and SVRs
+ *   129-144 of the Video Format Preference Data Block;
+ * - the checksums, the extension count, the Block Maps, the padding and
+ *   unused fields (such as the stereo mode bit of a non-stereo DTD or the
+ *   padding of a string descriptor) are dropped.
+ *
+ * Each line of the canonical form describes one item, the hash is the
+ * 64 bit FNV-1a hash of the canonical form.
+ */
+
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+
+#include "edid-view.h"
+
+static std::string hex(byte_view b)
+{
+	std::string s;
+	char buf[3];
+
+	for (unsigned i = 0; i < b.size(); i++) {
+		sprintf(buf, "%02x", b[i]);
+		s += buf;
+	}
+	return s.empty() ? "-" : s;
+}
+
+static std::string dtd2s(descriptor_view d)
+{
+	const byte_view &x = d.x;
+	unsigned flags = x[17];
+	char s[128];
+
+	// The stereo mode bit 0 is only used for stereo modes
+	if (!(flags & 0x60))
+		flags &= ~0x01;
+	sprintf(s, "%u %u %u %u %u %u %u %u %u %u %u %ux%u %02x",
+		d.pixclk_khz(),
+		d.hact(), d.hblank(), x[8] | ((x[11] & 0xc0) << 2), x[9] | ((x[11] & 0x30) << 4),
+		d.vact(), d.vblank(), (x[10] >> 4) | ((x[11] & 0x0c) << 2),
+		(x[10] & 0x0f) | ((x[11] & 0x03) << 4),
+		x[15], x[16],
+		x[12] | ((x[14] & 0xf0) << 4), x[13] | ((x[14] & 0x0f) << 8),
+		flags);
+	return s;
+}
+
+static void base_block(std::string &canon, std::vector<std::string> &dtds, base_block_view base)
+{
+	const byte_view &x = base.x;
+	std::set<std::string> items;
+	char pnp[4];
+	char s[128];
+
+	sprintf(s, "base %s:%04x %u.%u input=%02x size=%ux%u gamma=%02x features=%02x\n",
+		base.manufacturer(pnp), base.product(), base.version(), base.revision(),
+		x[0x14], x[0x15], x[0x16], x[0x17], x[0x18]);
+	canon += s;
+	canon += "chromaticity " + hex(x.sub(0x19, 10)) + "\n";
+	canon += "established " + hex(x.sub(0x23, 3)) + "\n";
+
+	for (unsigned i = 0; i < 8; i++) {
+		// 0x0101 is unused, 0x0000 is a common way to get that wrong
+		if (x[0x26 + i * 2] <= 0x01)
+			continue;
+		items.insert("std " + hex(x.sub(0x26 + i * 2, 2)));
+	}
+
+	for (unsigned i = 0; i < 4; i++) {
+		descriptor_view d = base.descriptor(i);
+		char str[14];
+
+		if (d.is_dtd()) {
+			if (!i)
+				canon += "preferred " + dtd2s(d) + "\n";
+			dtds.push_back("dtd " + dtd2s(d));
+			continue;
+		}
+		switch (d.tag()) {
+		case 0xff:	// Serial number
+		case 0x10:	// Dummy
+			break;
+		case 0xfc:
+			items.insert(std::string("name ") + d.string(str));
+			break;
+		case 0xfe:
+			items.insert(std::string("string ") + d.string(str));
+			break;
+		case 0xfd:
+			// The bytes after the timing support type are padding for 0x00 and 0x01
+			items.insert("range " + hex(d.x.sub(4, d.x[10] <= 0x01 ? 7 : 14)));
+			break;
+		default:
+			sprintf(s, "descriptor %02x ", d.tag());
+			items.insert(s + hex(d.x.sub(4)));
+			break;
+		}
+	}
+	for (const auto &i : items)
+		canon += i + "\n";
+}
+
+// Copy payload and clear the masked bytes
+static std::string masked(byte_view p, unsigned offset, unsigned n)
+{
+	std::vector<unsigned char> b(p.p, p.p + p.size());
+
+	for (unsigned i = offset; i < offset + n && i < b.size(); i++)
+		b[i] = 0;
+	return hex(byte_view(b.data(), b.size()));
+}
+
+// True if the HDMI VSDB has 3D_MASK or 2D_VIC_order fields
+static bool hdmi_3d_svd_indices(byte_view x)
+{
+	if (x.size() < 8 || !(x[7] & 0x20))
+		return false;
+
+	unsigned b = 8 + ((x[7] & 0x80) ? 2 : 0) + ((x[7] & 0x40) ? 2 : 0);
+
+	return (x[b] & 0x80) && (x[b + 1] & 0x1f);
+}
+
+// Check which blocks refer to SVDs or DTDs by their index
+static void index_refs(edid_view e, bool &svd_indices, bool &dtd_indices)
+{
+	for (auto blk : e.extensions()) {
+		for (auto db : cta_view(blk).data_blocks()) {
+			byte_view p = db.payload();
+
+			if (db.ext_tag() == 0x0f && !p.empty())
+				svd_indices = true;
+			if (db.oui() == 0x000c03 && hdmi_3d_svd_indices(p))
+				svd_indices = true;
+			if (db.ext_tag() == 0x0d)
+				for (unsigned i = 0; i < p.size(); i++)
+					if (p[i] >= 129 && p[i] <= 144)
+						dtd_indices = true;
+		}
+	}
+}
+
+static void cta_block(std::set<std::string> &dbs, std::vector<std::string> &vdbs,
+		      std::vector<std::string> &dtds, unsigned &flags, unsigned &revision,
+		      cta_view cta)
+{
+	char s[32];
+
+	flags |= cta.x[3] & 0xf0;
+	revision = max(revision, cta.revision());
+	for (auto db : cta.data_blocks()) {
+		byte_view p = db.payload();
+
+		if (db.is_ext())
+			sprintf(s, "cta-db %u.%02x ", db.tag(), db.ext_tag());
+		else
+			sprintf(s, "cta-db %u ", db.tag());
+		if (db.tag() == 0x02)
+			vdbs.push_back(s + hex(p));
+		// The Container ID of the Microsoft VSDB
+		else if (db.oui() == 0xca125c)
+			dbs.insert(s + masked(p, 5, 16));
+		else
+			dbs.insert(s + hex(p));
+	}
+	for (auto dtd : cta.dtds())
+		if (dtd.is_dtd())
+			dtds.push_back("dtd " + dtd2s(dtd));
+}
+
+static void displayid_block(std::set<std::string> &dbs, displayid_view d)
+{
+	char s[64];
+
+	sprintf(s, "displayid %u.%u product-type=%u", d.version() >> 4, d.version() & 0x0f,
+		d.product_type());
+	dbs.insert(s);
+	for (auto db : d.data_blocks()) {
+		byte_view p = db.payload();
+
+		sprintf(s, "displayid-db %02x.%02x ", db.tag(), db.x[1]);
+		switch (db.tag()) {
+		case 0x00:
+		case 0x20:
+			// Product Identification: serial number and manufacture date
+			dbs.insert(s + masked(p, 5, 6));
+			break;
+		case 0x12:
+		case 0x28:
+			// Tiled Display Topology: the serial number of the tile ID
+			dbs.insert(s + masked(p, 18, 4));
+			break;
+		case 0x29:
+			// ContainerID
+			dbs.insert(s + masked(p, 0, 16));
+			break;
+		default:
+			dbs.insert(s + hex(p));
+			break;
+		}
+	}
+}
+
+std::string semantic_canonical(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	std::set<std::string> cta_dbs, displayid_dbs, blocks;
+	std::vector<std::string> dtds, vdbs;
+	unsigned cta_flags = 0, cta_revision = 0;
+	bool has_cta = false;
+	bool svd_indices = false, dtd_indices = false;
+	std::string canon;
+
+	index_refs(e, svd_indices, dtd_indices);
+	base_block(canon, dtds, e.base());
+	for (auto blk : e.extensions()) {
+		cta_view cta(blk);
+		displayid_view displayid(blk);
+
+		if (cta.valid()) {
+			has_cta = true;
+			cta_block(cta_dbs, vdbs, dtds, cta_flags, cta_revision, cta);
+		} else if (displayid.valid()) {
+			displayid_block(displayid_dbs, displayid);
+		} else if (blk.tag() != 0xf0) {
+			// Other extension blocks without the checksum
+			char s[16];
+
+			sprintf(s, "block %02x ", blk.tag());
+			blocks.insert(s + hex(blk.x.sub(1, EDID_PAGE_SIZE - 2)));
+		}
+	}
+	if (!dtd_indices) {
+		std::sort(dtds.begin(), dtds.end());
+		dtds.erase(std::unique(dtds.begin(), dtds.end()), dtds.end());
+	}
+	if (!svd_indices) {
+		cta_dbs.insert(vdbs.begin(), vdbs.end());
+		vdbs.clear();
+	}
+	for (const auto &i : dtds)
+		canon += i + "\n";
+	if (has_cta) {
+		char s[64];
+
+		/*
+		 * The number of native DTDs is left out: it depends on where
+		 * the DTDs are placed.
+		 */
+		sprintf(s, "cta %u flags=%02x\n", cta_revision, cta_flags);
+		canon += s;
+	}
+	// Video Data Blocks that keep their order go where they would be sorted
+	std::set<std::string>::const_iterator vdb_pos = cta_dbs.lower_bound("cta-db 2 ");
+
+	for (std::set<std::string>::const_iterator i = cta_dbs.begin(); i != vdb_pos; ++i)
+		canon += *i + "\n";
+	for (const auto &i : vdbs)
+		canon += i + "\n";
+	for (std::set<std::string>::const_iterator i = vdb_pos; i != cta_dbs.end(); ++i)
+		canon += *i + "\n";
+	for (const auto &i : displayid_dbs)
+		canon += i + "\n";
+	for (const auto &i : blocks)
+		canon += i + "\n";
+	return canon;
+}
+
+unsigned long long semantic_hash(const unsigned char *edid, unsigned num_blocks)
+{
+	return fnv1a_64(semantic_canonical(edid, num_blocks));
+}
+
+int show_semantic_hash(const unsigned char *edid, unsigned num_blocks, bool canonical)
+{
+	if (canonical)
+		printf("%s", semantic_canonical(edid, num_blocks).c_str());
+	else
+		printf("%016llx\n", semantic_hash(edid, num_blocks));
+	return 0;
+}
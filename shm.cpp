@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Server side of the shared memory transport, see edid-shm.h.
+ *
+ * The result is written straight into the response slot: stdout is
+ * pointed at the response slot while decoding, so nothing is copied
+ * through pipes or sockets. The request is copied out of its slot, since
+ * the text formats are parsed from a NUL terminated buffer and the EDID
+ * itself is decoded from the global edid array.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include "edid-shm.h"
+#endif
+
+#include "edid-decode.h"
+
+#ifdef __linux__
+
+static volatile sig_atomic_t shm_stop;
+
+static void shm_signal(int sig)
+{
+	shm_stop = 1;
+}
+
+static void shm_handle(edid_shm_req &req, edid_shm_resp &resp, shm_decode_fn decode)
+{
+	std::vector<char> data(req.data, req.data + min(req.len, (uint32_t)EDID_SHM_REQ_SIZE));
+	FILE *f = fmemopen(resp.data, EDID_SHM_RESP_SIZE, "w");
+	FILE *saved_stdout = stdout;
+
+	resp.tag = req.tag;
+	resp.flags = 0;
+	if (!f) {
+		resp.len = snprintf(resp.data, EDID_SHM_RESP_SIZE, "%s\n", strerror(errno));
+		resp.status = -1;
+		return;
+	}
+	stdout = f;
+	resp.status = decode(data, req.flags & EDID_SHM_CHECK, req.flags & EDID_SHM_RAW);
+	if (fflush(f) || ferror(f))
+		resp.flags |= EDID_SHM_TRUNCATED;
+	resp.len = ftell(f);
+	stdout = saved_stdout;
+	fclose(f);
+}
+
+int shm_server(const char *name, shm_decode_fn decode)
+{
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	struct sigaction sa = {};
+
+	if (fd < 0) {
+		perror(name);
+		return -1;
+	}
+	if (ftruncate(fd, sizeof(edid_shm))) {
+		perror(name);
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+
+	void *p = mmap(NULL, sizeof(edid_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	edid_shm *shm = (edid_shm *)p;
+
+	close(fd);
+	if (p == MAP_FAILED) {
+		perror(name);
+		shm_unlink(name);
+		return -1;
+	}
+	// The new object is zeroed, clients only accept it once the magic is set
+	shm->version = EDID_SHM_VERSION;
+	shm->server_pid = getpid();
+	std::atomic_thread_fence(std::memory_order_release);
+	shm->magic = EDID_SHM_MAGIC;
+
+	// No SA_RESTART: a signal must interrupt the futex wait
+	sa.sa_handler = shm_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	uint32_t req_tail = 0, resp_head = 0;
+
+	while (!shm_stop) {
+		if (shm->req_head.v.load(std::memory_order_acquire) == req_tail) {
+			if (shm->shutdown.load())
+				break;
+			// Time out to pick up a shutdown request that raced with the wait
+			edid_shm_wait(shm->req_head, req_tail, 100);
+			continue;
+		}
+
+		uint32_t resp_tail = shm->resp_tail.v.load(std::memory_order_acquire);
+
+		if (resp_head - resp_tail == EDID_SHM_SLOTS) {
+			edid_shm_wait(shm->resp_tail, resp_tail, 100);
+			continue;
+		}
+		shm_handle(shm->req[req_tail % EDID_SHM_SLOTS],
+			   shm->resp[resp_head % EDID_SHM_SLOTS], decode);
+		edid_shm_set(shm->req_tail, ++req_tail);
+		edid_shm_set(shm->resp_head, ++resp_head);
+	}
+	munmap(p, sizeof(edid_shm));
+	shm_unlink(name);
+	return 0;
+}
+
+#else
+
+int shm_server(const char *name, shm_decode_fn decode)
+{
+	fprintf(stderr, "The shared memory transport is only supported on Linux.\n");
+	return -1;
+}
+
+#endif
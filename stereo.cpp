@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Resolve the stereo 3D formats of each mode.
+ *
+ * Stereo support is spread over the HDMI VSDB (3D_present, which makes
+ * some formats mandatory for the 1080p24, 720p and 1080i VICs, the
+ * 3D_Structure_ALL formats and 3D_MASK, which apply to the first 16 SVDs,
+ * and the 2D_VIC_order entries, which add formats to a single SVD), the
+ * stereo flags of the DTDs and the 3D stereo support of the DisplayID
+ * Type I, VII and IX timings, whose format is given by the Stereo Display
+ * Interface Data Block. stereo_modes() combines all of these into a set of
+ * STEREO_* formats per mode, reading the EDID through the edid-view.h
+ * views without decoding it.
+ */
+
+#include <stdio.h>
+
+#include "edid-view.h"
+
+static const struct {
+	unsigned format;
+	const char *name;
+} stereo_format_names[] = {
+	{ STEREO_FRAME_PACKING, "frame packing" },
+	{ STEREO_FIELD_ALTERNATIVE, "field alternative" },
+	{ STEREO_LINE_ALTERNATIVE, "line alternative" },
+	{ STEREO_SIDE_BY_SIDE_FULL, "side-by-side (full)" },
+	{ STEREO_L_DEPTH, "L + depth" },
+	{ STEREO_L_DEPTH_GFX, "L + depth + gfx + gfx-depth" },
+	{ STEREO_TOP_AND_BOTTOM, "top-and-bottom" },
+	{ STEREO_SIDE_BY_SIDE_HALF, "side-by-side (half)" },
+	{ STEREO_SIDE_BY_SIDE_QUINCUNX, "side-by-side (half, quincunx)" },
+	{ STEREO_FIELD_SEQUENTIAL, "field sequential" },
+	{ STEREO_INTERLEAVED, "interleaved" },
+	{ STEREO_DUAL_INTERFACE, "dual interface" },
+	{ STEREO_MULTI_VIEW, "multi-view" },
+	{ STEREO_PROPRIETARY, "proprietary" },
+	{ STEREO_UNSPECIFIED, "unspecified" },
+	{ STEREO_USER_ACTION, "depends on user action" },
+};
+
+std::string stereo_formats2s(unsigned formats)
+{
+	std::string s;
+
+	for (const auto &f : stereo_format_names)
+		if (formats & f.format)
+			s += (s.empty() ? "" : ", ") + std::string(f.name);
+	return s;
+}
+
+static stereo_mode make_mode(const std::string &source, const timings &t)
+{
+	return { source, t.hact, t.vact, t.interlaced, refresh_hz(t), 0 };
+}
+
+// The formats of a 2D_VIC_order entry, 0 if reserved
+static unsigned structure_formats(unsigned structure, unsigned detail)
+{
+	if (structure <= 6)
+		return 1U << structure;
+	if (structure != 8)
+		return 0;
+	// 3D_Detail: 0 is any subsampling, 1 horizontal, 6 and up quincunx
+	if (!detail)
+		return STEREO_SIDE_BY_SIDE_HALF | STEREO_SIDE_BY_SIDE_QUINCUNX;
+	if (detail == 1)
+		return STEREO_SIDE_BY_SIDE_HALF;
+	return detail >= 6 ? STEREO_SIDE_BY_SIDE_QUINCUNX : 0;
+}
+
+/*
+ * Add the 3D formats of the HDMI VSDB to the SVD modes. The payload
+ * includes the OUI, the latency fields are optional.
+ */
+static void parse_hdmi_3d(std::vector<stereo_mode> &svds, const std::vector<unsigned char> &vics,
+			  byte_view x)
+{
+	if (x.size() < 8 || !(x[7] & 0x20))
+		return;
+
+	unsigned b = 8 + ((x[7] & 0x80) ? 2 : 0) + ((x[7] & 0x40) ? 2 : 0);
+	bool present = x[b] & 0x80;
+	unsigned multi = (x[b] >> 5) & 0x03;
+	unsigned len_vic = x[b + 1] >> 5;
+	unsigned len_3d = x[b + 1] & 0x1f;
+
+	b += 2 + len_vic;
+	if (!present)
+		return;
+
+	// The mandatory formats of HDMI 1.4b section 8.3.2
+	for (unsigned i = 0; i < svds.size(); i++) {
+		switch (vics[i]) {
+		case 32: case 4: case 19:
+			svds[i].formats |= STEREO_FRAME_PACKING | STEREO_TOP_AND_BOTTOM;
+			break;
+		case 5: case 20:
+			svds[i].formats |= STEREO_SIDE_BY_SIDE_HALF;
+			break;
+		}
+	}
+
+	unsigned end = min(b + len_3d, x.size());
+
+	if ((multi == 1 || multi == 2) && b + 2 <= end) {
+		unsigned all = (x[b] << 8) | x[b + 1];
+		unsigned mask = 0xffff;
+
+		b += 2;
+		if (multi == 2 && b + 2 <= end) {
+			mask = (x[b] << 8) | x[b + 1];
+			b += 2;
+		}
+		for (unsigned i = 0; i < 16 && i < svds.size(); i++)
+			if (mask & (1 << i))
+				svds[i].formats |= all;
+	}
+
+	while (b < end) {
+		unsigned idx = x[b] >> 4;
+		unsigned structure = x[b] & 0x0f;
+		unsigned detail = structure >= 8 ? x[b + 1] >> 4 : 0;
+
+		if (idx < svds.size())
+			svds[idx].formats |= structure_formats(structure, detail);
+		b += structure >= 8 ? 2 : 1;
+	}
+}
+
+static void parse_dtd(std::vector<stereo_mode> &modes, descriptor_view d, unsigned n)
+{
+	static const unsigned dtd_formats[8] = {
+		0, 0,
+		STEREO_FIELD_SEQUENTIAL,	// 0x20: right image on sync
+		STEREO_INTERLEAVED,		// 0x21: 2-way interleaved, right image on even lines
+		STEREO_FIELD_SEQUENTIAL,	// 0x40: left image on sync
+		STEREO_INTERLEAVED,		// 0x41: 2-way interleaved, left image on even lines
+		STEREO_INTERLEAVED,		// 0x60: 4-way interleaved
+		STEREO_SIDE_BY_SIDE_HALF,	// 0x61: side-by-side interleaved
+	};
+	unsigned flags = d.x[17];
+	unsigned formats = dtd_formats[((flags & 0x60) >> 4) | (flags & 0x01)];
+
+	if (!d.is_dtd() || !formats)
+		return;
+
+	modes.push_back(make_mode("DTD " + std::to_string(n), d.dtd_timings()));
+	modes.back().formats = formats;
+}
+
+// The formats of the Stereo Display Interface Data Block
+static unsigned stereo_intf_formats(byte_view p)
+{
+	switch (p[1]) {
+	case 0x00: return STEREO_FIELD_SEQUENTIAL;
+	case 0x01: return STEREO_SIDE_BY_SIDE_HALF;
+	case 0x02: return STEREO_INTERLEAVED;
+	case 0x03: return STEREO_DUAL_INTERFACE;
+	case 0x04: return STEREO_MULTI_VIEW;
+	case 0x05: return STEREO_TOP_AND_BOTTOM;
+	case 0xff: return STEREO_PROPRIETARY;
+	default: return STEREO_UNSPECIFIED;
+	}
+}
+
+static void parse_displayid(std::vector<stereo_mode> &modes, displayid_view d)
+{
+	unsigned formats = STEREO_UNSPECIFIED;
+	bool all_timings = false;
+	unsigned n = 0;
+
+	for (auto db : d.data_blocks())
+		if (db.tag() == 0x10 || db.tag() == 0x27) {
+			formats = stereo_intf_formats(db.payload());
+			all_timings = (db.x[1] >> 6) == 0x02;
+		}
+
+	for (auto db : d.data_blocks()) {
+		byte_view p = db.payload();
+		bool type9 = db.tag() == 0x24;
+		unsigned size = type9 ? 6 : 20;
+
+		if (db.tag() != 0x03 && db.tag() != 0x22 && !type9)
+			continue;
+		for (unsigned i = 0; i + size <= p.size(); i += size) {
+			byte_view x = p.sub(i, size);
+			unsigned stereo = ((type9 ? x[0] : x[3]) >> 5) & 0x03;
+			std::string source = std::string("DisplayID Type ") +
+				(type9 ? "IX " : db.tag() == 0x22 ? "VII " : "I ") +
+				std::to_string(++n);
+			timings t = {};
+
+			if (stereo == 0x03 || (!stereo && !all_timings))
+				continue;
+			if (type9) {
+				stereo_mode m = { source, x.le16(1) + 1, x.le16(3) + 1, false,
+						  x[5] + 1.0, 0 };
+
+				modes.push_back(m);
+			} else {
+				t.pixclk_khz = (db.tag() == 0x22 ? 1 : 10) * (1 + x.le24(0));
+				t.hact = 1 + x.le16(4);
+				t.hfp = 1 + x.le16(6);
+				t.vact = 1 + x.le16(12);
+				t.vfp = 1 + x.le16(14);
+				// vact is the frame height, the blanking is per frame
+				if (x[3] & 0x10) {
+					t.interlaced = true;
+					t.vfp /= 2;
+				}
+				modes.push_back(make_mode(source, t));
+			}
+			modes.back().formats = formats | (stereo == 0x02 ? STEREO_USER_ACTION : 0);
+		}
+	}
+}
+
+std::vector<stereo_mode> stereo_modes(const unsigned char *edid, unsigned num_blocks)
+{
+	edid_view e(edid, num_blocks * EDID_PAGE_SIZE);
+	std::vector<stereo_mode> svds, modes;
+	std::vector<unsigned char> vics;
+	std::vector<byte_view> hdmi_vsdbs;
+	unsigned num_dtds = 0;
+
+	for (unsigned i = 0; i < 4; i++)
+		if (e.base().descriptor(i).is_dtd())
+			parse_dtd(modes, e.base().descriptor(i), ++num_dtds);
+
+	for (auto blk : e.extensions()) {
+		cta_view cta(blk);
+
+		for (auto db : cta.data_blocks()) {
+			svd_view v(db);
+
+			for (unsigned i = 0; i < v.count(); i++) {
+				const timings *t = find_vic_id(v.vic(i));
+
+				vics.push_back(v.vic(i));
+				svds.push_back(make_mode("VIC " + std::to_string(v.vic(i)),
+							 t ? *t : timings()));
+			}
+			if (db.oui() == 0x000c03)
+				hdmi_vsdbs.push_back(db.payload());
+		}
+		if (cta.valid())
+			for (auto dtd : cta.dtds())
+				parse_dtd(modes, dtd, ++num_dtds);
+		parse_displayid(modes, displayid_view(blk));
+	}
+	for (auto x : hdmi_vsdbs)
+		parse_hdmi_3d(svds, vics, x);
+
+	// Merge the SVDs of the same VIC
+	std::vector<stereo_mode> result;
+
+	for (unsigned i = 0; i < svds.size(); i++) {
+		unsigned j;
+
+		for (j = 0; j < result.size(); j++)
+			if (result[j].source == svds[i].source)
+				break;
+		if (j < result.size())
+			result[j].formats |= svds[i].formats;
+		else if (svds[i].formats)
+			result.push_back(svds[i]);
+	}
+	result.insert(result.end(), modes.begin(), modes.end());
+	return result;
+}
+
+int show_stereo_modes(const unsigned char *edid, unsigned num_blocks)
+{
+	std::vector<stereo_mode> modes = stereo_modes(edid, num_blocks);
+
+	if (modes.empty()) {
+		printf("No stereo 3D modes.\n");
+		return 0;
+	}
+	printf("Stereo 3D modes:\n");
+	for (const auto &m : modes) {
+		char buf[16];
+
+		sprintf(buf, "%u%s", m.vact, m.interlaced ? "i" : "");
+		printf("  %-22s %5ux%-5s %7.3f Hz: %s\n", m.source.c_str(), m.hact, buf,
+		       m.refresh, stereo_formats2s(m.formats).c_str());
+	}
+	return 0;
+}